@@ -0,0 +1,86 @@
+/*
+ * blit.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ * This file contains a small blitter to draw sprites into images. By that
+ * several layers (like an animation, a text & a small sprite) can be combined
+ * to one image before it is displayed.
+ * The sprite can be moved in single pixels - even partly out of the image.
+ * Each row of the sprite is shifted to its column, with a mask of the
+ * columns it covers. Rows outside of the image are skipped.
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+//we need the standard integer types
+#include <stdint.h>
+
+//and we need our own definitions
+#include "blit.h"
+
+/*
+ * Draw a sprite into an image.
+ */
+void
+blit_sprite(uint8_t image[], const uint8_t sprite[], int8_t x, int8_t y,
+    uint8_t mode)
+{
+  //completely outside - nothing to do
+  if ((x <= -8) || (x >= 8) || (y <= -8) || (y >= 8))
+    {
+      return;
+    }
+  //the columns of the image covered by the sprite
+  uint8_t mask;
+  if (x >= 0)
+    {
+      mask = 0xff << x;
+    }
+  else
+    {
+      mask = 0xff >> -x;
+    }
+  //only the rows of the sprite inside of the image
+  uint8_t row = (y > 0) ? y : 0;
+  uint8_t end = (y < 0) ? 8 + y : 8;
+  for (; row < end; row++)
+    {
+      uint8_t pixels = sprite[row - y];
+      if (x >= 0)
+        {
+          pixels <<= x;
+        }
+      else
+        {
+          pixels >>= -x;
+        }
+      switch (mode)
+        {
+      case BLIT_OR:
+        image[row] |= pixels;
+        break;
+      case BLIT_XOR:
+        image[row] ^= pixels;
+        break;
+      case BLIT_AND:
+        image[row] &= pixels | ~mask;
+        break;
+      default:
+        image[row] = (image[row] & ~mask) | pixels;
+        break;
+        }
+    }
+}
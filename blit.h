@@ -0,0 +1,45 @@
+/*
+ * blit.h
+ *
+ * This file contains a small blitter to draw sprites into images.
+ *
+ *  http://interactive-matter.eu/
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BLIT_H_
+#define BLIT_H_
+
+/*
+ * How the pixels of the sprite are combined with the pixels of the image.
+ * Only the part of the image covered by the sprite is changed.
+ */
+//the sprite replaces the image
+#define BLIT_REPLACE 0
+//pixels of the sprite are switched on
+#define BLIT_OR 1
+//pixels of the sprite switch the pixels of the image (on to off & off to on)
+#define BLIT_XOR 2
+//only pixels of the image which are also on in the sprite stay on
+#define BLIT_AND 3
+
+//draw a sprite (8x8) into an image with its top left corner at column x &
+//row y (-7 to 7) - what is outside of the image is not drawn
+void blit_sprite(uint8_t image[], const uint8_t sprite[], int8_t x, int8_t y,
+    uint8_t mode);
+
+#endif /* BLIT_H_ */
@@ -56,6 +56,24 @@ const prog_uint8_t default_sprites[][8] = {
   }
 };
 
+/*
+ * The dot correction.
+ * If we light only one LED in a row it gets much brighter than if we display
+ * all 8 LEDs in a row, since the internal resistance of the battery is that
+ * high (and the ATmega struggles to sink all the current).
+ * Therefore each row is displayed shorter the less LEDs are lit in it. Here is
+ * the on-time for rows with 0 to 8 lit LEDs in 1/16 of the on-time of a row
+ * with all 8 LEDs lit. Values below 16 make the row darker. A row with 0 LEDs
+ * is not displayed at all.
+ * With the unit of 64 us (see DISPLAY_BCM_UNIT) each step is exactly 4 us,
+ * so the timer can display every value of the table. Values below 8 are
+ * displayed as 8 (see DISPLAY_MIN_BCM_UNIT).
+ * Use tools/duty-model to check the resulting brightness without hardware -
+ * these values are tuned for its default droop of 0.12.
+ */
+const prog_uint8_t dot_correction[9] =
+  { 16, 9, 10, 11, 12, 13, 14, 15, 16 };
+
 const prog_uint8_t font[] = {
   // 3 chars bitmap, 1 char length
    0x00, 0x00, 0x00, 0x01 ,             // 0x20, 32, ' '
@@ -34,6 +34,12 @@
  * The default sprites which are always present as fallback
  */
 extern const prog_uint8_t default_sprites[][8];
+
+/*
+ * The dot correction: How long a row with 0 to 8 lit LEDs is displayed, in
+ * 1/16 of the time for a row with all LEDs lit.
+ */
+extern const prog_uint8_t dot_correction[9];
 //where does the first character of the font start. The ASCII number - CHAR_OFFSET
 //is the index in the font
 #define CHAR_OFFSET 0x20
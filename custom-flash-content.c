@@ -28,59 +28,91 @@
 #include <avr/pgmspace.h>
 
 #include "custom-flash-content.h"
+//the sequences can use effects
+#include "effects.h"
+//and transformed sprites
+#include "transform.h"
+//messages can be drawn over the animations
+#include "blit.h"
 
-//how often should we display messages - bigger values mean
-//less probability to display a message
-const uint8_t message_probability = 10;
-//how many chars has the longest message
-#define MAX_MESSAGE_LENGTH 40
-//a buffer for loading messages from flash
-char message[MAX_MESSAGE_LENGTH];
+//how often should we display messages - the seconds between the end of a
+//message and the next one
+const uint8_t message_interval = 20;
+//in which order are the messages shown (PLAYLIST_RANDOM or PLAYLIST_SHUFFLE)
+const uint8_t message_playlist = PLAYLIST_SHUFFLE;
 
 /*
  * Here you can define the messages. If you want to have more than three
  * messages just add another message_0x. But remember to also increase the
  * total number of messages in max_messages and add it to the array messages.
+ * The messages are read directly from flash, so they can be as long as you
+ * want.
  */
 const prog_char message_00[] = "INTERACTIVE-MATTER.ORG";
 const prog_char message_01[] = "SPACE INVADERS BUTTON";
 const prog_char message_02[] = "SPACE INVADERS AGAINST RACISM";
 //how much messages do we have in total (see message_00 _01 ...)
 const uint8_t max_messages = 3;
-//if you define new messages remember to add it here
-const PGM_P PROGMEM messages[] =
-  { message_00, message_01, message_02 };
+/*
+ * if you define new messages remember to add it here
+ * First the speed of the text in columns per second (the higher, the faster).
+ * Second how the text is drawn over the animation (see blit.h): BLIT_REPLACE
+ * stops the animation and shows only the text, the others show the text as
+ * ticker over the animation.
+ * Third the message.
+ */
+const _message_struct messages[] PROGMEM =
+  {
+        { ANIMATION_TEXT_SPEED(10), BLIT_REPLACE, message_00 },
+        { ANIMATION_TEXT_SPEED(10), BLIT_XOR, message_01 },
+        { ANIMATION_TEXT_SPEED(12.5), BLIT_REPLACE, message_02 } };
 
 
 //our animations
 //first number is # sprites
-const prog_uint8_t sprite_0[] =
+//a sprite can be transformed, like SPRITE_TRANSFORM(6, TRANSFORM_INVERT)
+const prog_uint16_t sprite_0[] =
   { 2, 0, 1 };
-const prog_uint8_t sprite_1[] =
+const prog_uint16_t sprite_1[] =
   { 2, 2, 3 };
-const prog_uint8_t sprite_2[] =
+const prog_uint16_t sprite_2[] =
   { 2, 4, 5 };
-const prog_uint8_t sprite_3[] =
+const prog_uint16_t sprite_3[] =
   { 8, 14, 15, 16, 11, 11, 16, 15, 14 };
-const prog_uint8_t sprite_4[] =
+const prog_uint16_t sprite_4[] =
   { 7, 8, 9, 10, 11, 10, 9, 8 };
+const prog_uint16_t sprite_5[] =
+  { 2, 6, SPRITE_TRANSFORM(6, TRANSFORM_INVERT) };
 
 //how many sequences do we have?
-const uint8_t max_sequence = 6;
+const uint8_t max_sequence = 11;
+//in which order are the sequences shown (PLAYLIST_RANDOM or PLAYLIST_SHUFFLE)
+const uint8_t sequence_playlist = PLAYLIST_SHUFFLE;
 /*the definition of the sequences as array of _sequence_struct (see above):
- * First the display speed (lower numbers are faster since it is more a wait timer.
- * Second the length, how long the animation is shown.
- * Third the animation.
+ * First the display speed - how long each sprite is displayed in ms (lower
+ * numbers are faster).
+ * Second the length, how long the animation is shown in seconds.
+ * Third the weight, how often the sequence is shown compared to the others -
+ * a sequence with weight 2 is shown twice as often as one with weight 1.
+ * Fourth the animation.
+ * Or instead of the animation 0 and an effect (see effects.h) - the effect
+ * calculates each sprite.
  */
 const _sequence_struct sequences[] PROGMEM =
   {
-  //the first two sprites are defined twice - to ensure that they are shown more often
-        { 14, 20, sprite_0 },
-        { 14, 20, sprite_1 },
-        { 14, 20, sprite_0 },
-        { 14, 20, sprite_1 },
-        { 3, 5, sprite_3 },
-        { 3, 5, sprite_4 } };
+  //the first two sprites are shown more often
+        { 490, 40, 2, sprite_0 },
+        { 490, 40, 2, sprite_1 },
+        { 130, 12, 1, sprite_3 },
+        { 130, 12, 1, sprite_4 },
+        { 490, 10, 1, sprite_5 },
+        { 250, 20, 1, 0, EFFECT_LIFE },
+        { 100, 10, 1, 0, EFFECT_RAIN },
+        { 80, 10, 1, 0, EFFECT_FIRE },
+        { 60, 10, 1, 0, EFFECT_PLASMA },
+        //the programs of custom-programs.vm
+        { 490, 60, 1, 0, EFFECT_NONE, SEQUENCE_PROGRAM(0) },
+        { 130, 60, 1, 0, EFFECT_NONE, SEQUENCE_PROGRAM(1) } };
 
 /*
  * This is the definition of sprites that are usable. The bit pattern on the
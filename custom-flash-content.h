@@ -24,25 +24,71 @@
 #ifndef CUSTOM_FLASH_CONTENT_H_
 #define CUSTOM_FLASH_CONTENT_H_
 
-//a sequence is a animation + display speed an length
+/*
+ * A sprite in an animation can be transformed (see transform.h), e.g.
+ * SPRITE_TRANSFORM(6, TRANSFORM_INVERT) is sprite 6 inverted.
+ */
+#define SPRITE_TRANSFORM(sprite, transform) (((transform) << 8) | (sprite))
+#define SPRITE_INDEX(sprite) ((sprite) & 0xff)
+#define SPRITE_TRANSFORMATION(sprite) ((sprite) >> 8)
+
+//a sequence is a animation + display speed (ms per sprite) an length (s)
+//and a weight (how often it is shown compared to the other sequences)
+//the animation is compressed to sequence_frames[] while building
+//instead of an animation a sequence can show an effect (see effects.h)
+//or run a program (see vm.h) - use SEQUENCE_PROGRAM(number) for it
 typedef struct
 {
-  uint8_t display_speed;
+  uint16_t display_speed;
   uint8_t display_length;
-  const prog_uint8_t* sprites;
+  uint8_t weight;
+  const prog_uint16_t* sprites;
+  uint8_t effect;
+  uint8_t program;
 } _sequence_struct;
 
-//a buffer for loading messages from flash
-extern char message[];
+//the programs are counted from 1 - 0 is no program
+#define SEQUENCE_PROGRAM(number) ((number) + 1)
+
+/*
+ * The order of the sequences & messages:
+ * PLAYLIST_RANDOM - each time a random one (by the weight for sequences)
+ * PLAYLIST_SHUFFLE - all in random order, each once (sequences as often as
+ *  their weight) - then again in another order
+ */
+#define PLAYLIST_RANDOM 0
+#define PLAYLIST_SHUFFLE 1
+
+/*
+ * The speed of a text in columns per second, e.g. ANIMATION_TEXT_SPEED(12.5).
+ * It is stored as fixed point number with 8 bits for the fraction (1/256
+ * columns per second) - so the fastest text has 255 columns per second.
+ */
+#define ANIMATION_TEXT_SPEED(columns_per_second) \
+  ((uint16_t) ((columns_per_second) * 256))
+
+//a message is a text + the speed of the text + how it is drawn over the
+//animation (see blit.h)
+typedef struct
+{
+  uint16_t scroll_speed;
+  uint8_t mode;
+  PGM_P text;
+} _message_struct;
+
 //how much messages do we have in total
 extern const uint8_t max_messages;
 //the messages
-extern const PGM_P PROGMEM messages[];
-//how often should we display messages
-extern const uint8_t message_probability;
+extern const _message_struct messages[] PROGMEM;
+//how often should we display messages (seconds between them)
+extern const uint8_t message_interval;
+//and in which order
+extern const uint8_t message_playlist;
 
 //how many sequences do we have?
 extern const uint8_t max_sequence;
+//and in which order are they shown
+extern const uint8_t sequence_playlist;
 
 extern const _sequence_struct sequences[] PROGMEM;
 
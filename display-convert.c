@@ -0,0 +1,137 @@
+/*
+ * display-convert.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ * This file contains the conversion of images to the display format. It does
+ * not touch any hardware, so it is used by the display and by the model of
+ * the dot correction in tools/duty-model.c.
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+//we need the standard integer types
+#include <stdint.h>
+//we need some special register and tool definitions
+#include <avr/sfr_defs.h>
+//the dot correction is stored in the flash
+#include <avr/pgmspace.h>
+
+//we need the dot correction table
+#include "core-flash-content.h"
+//and we need our own definitions
+#include "display.h"
+
+/*
+ * The bit plane unit for each number of displayed rows. Dark rows are not
+ * displayed, so the other rows get their time: the unit for n rows is
+ * DISPLAY_BCM_UNIT * 8 / n - capped to DISPLAY_MAX_BCM_UNIT.
+ */
+#define DISPLAY_ROWS_UNIT(rows) \
+  (((DISPLAY_BCM_UNIT * 8 / (rows)) > DISPLAY_MAX_BCM_UNIT) ? \
+      DISPLAY_MAX_BCM_UNIT : (DISPLAY_BCM_UNIT * 8 / (rows)))
+const prog_uint8_t display_rows_unit[9] =
+  { DISPLAY_MAX_BCM_UNIT, DISPLAY_ROWS_UNIT(1), DISPLAY_ROWS_UNIT(2),
+      DISPLAY_ROWS_UNIT(3), DISPLAY_ROWS_UNIT(4), DISPLAY_ROWS_UNIT(5),
+      DISPLAY_ROWS_UNIT(6), DISPLAY_ROWS_UNIT(7), DISPLAY_ROWS_UNIT(8) };
+
+/*
+ * Converts an 8x8 bit matrix (8 bytes) to the display format.
+ * Each lit LED is shown at full brightness, so the row is simply copied to all
+ * bit planes.
+ */
+void
+display_convert_sprite(display_line lines[], uint8_t origin[])
+{
+  uint8_t row;
+  for (row = 0; row < 8; row++)
+    {
+      uint8_t planes[DISPLAY_BIT_PLANES];
+      uint8_t plane;
+      for (plane = 0; plane < DISPLAY_BIT_PLANES; plane++)
+        {
+          planes[plane] = origin[row];
+        }
+      display_convert_row(&lines[row], row, planes);
+    }
+}
+
+/*
+ * Converts the bit planes of a row to the display struct.
+ * The number of activated bits (=LEDs) is counted to enable some dot
+ * correction (see display_get_row_unit).
+ */
+void
+display_convert_row(display_line* line, uint8_t row, uint8_t planes[])
+{
+  //first we set all pins to low
+  uint8_t pb = 0;
+  uint8_t pc = 0;
+
+  //select the correct row
+  //this will switch on the row transistor
+  //bits 0 to 5 are set on the port c, bit 6-8
+  //is set on port c.
+  if (row < 6)
+    {
+      pc |= _BV(row);
+    }
+  else
+    {
+      pb |= _BV(row) >> 6;
+    }
+  //calculate the number of active bits - an LED is active if it is lit in
+  //any of the bit planes
+  uint8_t lit = 0;
+  uint8_t plane;
+  for (plane = 0; plane < DISPLAY_BIT_PLANES; plane++)
+    {
+      lit |= planes[plane];
+      //enable the drain for the selected lines
+      line->pd[plane] = planes[plane];
+    }
+  line->num_bit = 0;
+  for (int i = 0; i < 8; i++)
+    {
+      if (lit & _BV(i))
+        {
+          line->num_bit++;
+        }
+    }
+
+  //save the calculated values to the sprite
+  line->pb = pb;
+  line->pc = pc;
+}
+
+/*
+ * Calculates the bit plane unit (in timer ticks) for a row with 'num_bit' lit
+ * LEDs if 'rows' rows of the image are displayed.
+ * The dot correction table contains the on-time of a row in 1/16 of the
+ * unit of a full row. So rows with less LEDs are displayed shorter to get
+ * the same brightness for all LEDs. The unit is rounded to the next timer
+ * tick - cutting it off would make some neighbouring steps the same.
+ */
+uint8_t
+display_get_row_unit(uint8_t rows, uint8_t num_bit)
+{
+  uint16_t unit = pgm_read_byte(&display_rows_unit[rows]);
+  unit = (unit * pgm_read_byte(&dot_correction[num_bit]) + 8) >> 4;
+  if (unit < DISPLAY_MIN_BCM_UNIT)
+    {
+      return DISPLAY_MIN_BCM_UNIT;
+    }
+  return unit;
+}
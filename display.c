@@ -27,10 +27,17 @@
  *  which goes through the rows 0 to 7 and sets the ports to the corresponding
  *  values to light the correct LEDs.
  *  The values are stored directly as values used to apply to the ports.
- *  The display has two buffers to store the output values. One buffer that is
- *  currently displayed and one buffer where the next image can be stored.
+ *  The display has a ring of DISPLAY_FRAMES buffers to store the output
+ *  values: the renderer writes the next image into the loading buffer and
+ *  puts it into the ring, the display timer takes the frames out of the ring
+ *  one after the other. Each side only moves its own index (see
+ *  display_current_buffer) - so no locking is needed.
  *  While loading a sprite from an 8 byte array (each byte representing a row)
  *  it gets converted to the port values to ensure a fast computation.
+ *  Each LED has 3 bits of brightness. The rows are stored as bit planes and
+ *  each bit plane is displayed as long as its significance (Binary Code
+ *  Modulation). So the timer goes through the rows 0 to 7 once for each bit
+ *  plane.
  */
 //include the definitions for our chip, like pins, ports & so on
 #include <avr/io.h>
@@ -45,8 +52,6 @@
 
 //we are using states to track activity
 #include "state.h"
-//we need some basic definitions for fonts & default sprites
-#include "core-flash-content.h"
 //and we need our own definitions
 #include "display.h"
 
@@ -62,58 +67,156 @@ void
 display_start_row_timer(void);
 
 /*
- * the current row, which is rendered. It is stored in a register
- * to ensure a fast update of the value - since it will get updated
- * pretty often.
+ * signal that a new frame is loaded
+ */
+void
+display_start_loading(void);
+
+/*
+ * list the rows of a frame which are not dark
+ */
+void
+display_list_rows(uint8_t number);
+
+/*
+ * advance to the next row & plane to display
+ */
+void
+display_next_row(void);
+
+/*
+ * put the loaded frame into the ring, to be displayed at least 'scans' scans
+ */
+void
+display_queue_buffer(uint8_t scans);
+
+/*
+ * The timer runs at F_CPU/8 = 1 MHz, so one timer tick is 1 us. Each row is
+ * displayed once for each bit plane. The time a plane is displayed is
+ * proportional to the significance of the bit plane:
+ *   plane 0: DISPLAY_BCM_UNIT       =  64 us
+ *   plane 1: DISPLAY_BCM_UNIT * 2   = 128 us
+ *   plane 2: DISPLAY_BCM_UNIT * 4   = 256 us
+ * So a row is displayed for 448 us and a complete frame (8 rows) takes
+ * 3,584 us. This results in a 'frame rate' of 279 FPS with just 24 interrupts
+ * per frame - we need one interrupt per bit plane, not one per gray level.
+ * (8 levels in software PWM would need 7 interrupts per row).
+ *
+ * Why not more bit planes & a faster frame rate? Each plane needs an
+ * interrupt, which takes about DISPLAY_ISR_TICKS (25 us). If a plane is
+ * shorter than that the interrupt would have to wait for it and the CPU is
+ * busy all the time. The longest plane must fit into the 8 bit timer
+ * (256 us), and the dot correction needs planes down to half the unit. So
+ * with 4 bit planes the least significant plane would be 16 us at most -
+ * 3 bit planes with at least 32 us are the compromise. About 17% of the CPU
+ * are spent in the interrupt (33% if all rows are dot corrected to the
+ * minimum, see tools/duty-model).
+ * FPS rates below 1,000Hz lead to POV flicker effects when shaking the
+ * device (or moving the eyes quickly over it). Below about 250 FPS it
+ * flickers even if you just look at it.
+ *
+ * Rows without any lit LED are not displayed at all. Instead the remaining
+ * rows are displayed longer - so they get brighter and the display needs less
+ * interrupts. The unit for n rows is DISPLAY_BCM_UNIT * 8 / n, so a frame
+ * never takes longer than with all 8 rows and never drops below 279 FPS.
+ * DISPLAY_MAX_BCM_UNIT caps the unit, since the longest plane must fit into
+ * the 8 bit timer.
+ *
+ * The unit is further adjusted for each row by the dot correction: Rows with
+ * less lit LEDs are displayed shorter, since each LED gets more current (see
+ * dot_correction in core-flash-content.c). So the on-time for each row is
+ * just a different compare value - the dot correction needs no additional
+ * interrupts.
+ */
+/*
+ * the current position in the list of displayed rows (bits 0-2) and the
+ * current bit plane (bits 3-4). Only the display timer uses it.
+ * It used to be bound to a register, but then every other module must be
+ * compiled without using that register (see
+ * http://www.nongnu.org/avr-libc/user-manual/FAQ.html#faq_regbind) - and
+ * the precompiled library routines (e.g. for 64 bit math) use it anyway.
  * Like all variables this is initialized with value 0
- * see http://www.nongnu.org/avr-libc/user-manual/FAQ.html#faq_regbind
  */
-register uint8_t display_curr_row asm("r2");
+uint8_t display_curr_row;
 
 /*
- * Which of the buffers is currently displayed 0 or 1
+ * The display buffers form a ring of DISPLAY_FRAMES frames. The renderer
+ * (outside of the interrupt) is the only one writing frames into the ring and
+ * the display timer is the only one taking frames out of it. So each side has
+ * its own index and only ever changes its own index - no locking is needed:
+ *  - display_current_buffer is the frame currently displayed. Only the
+ *    display timer changes it.
+ *  - display_load_buffer is the frame the renderer is writing to. Only the
+ *    renderer changes it, after the frame is completely written.
+ * All frames after the displayed frame up to the loaded frame are waiting to
+ * be displayed. Since the displayed frame is never the loaded frame the
+ * renderer never writes to a frame which is displayed.
  * Like all variables this is initialized with value 0
  */
-uint8_t display_current_buffer;
+volatile uint8_t display_current_buffer;
+volatile uint8_t display_load_buffer = 1;
+/*
+ * How many complete scans each frame in the ring is displayed at least
+ */
+volatile uint8_t display_frame_scans[DISPLAY_FRAMES];
+/*
+ * How many scans the current frame is still displayed. Only used by the
+ * display timer.
+ */
+uint8_t display_scans_left;
 /*
  * For the display we track an additional state:
- *  - is the buffer locked
- *  - should we switch buffers?
- * This value is often needed and often updated - so we store it in a register
- * too for faster access.
+ *  - is a frame loaded, which is not in the ring yet?
+ * Only the renderer changes it, the display timer just reads it.
  * Like all variables this is initialized with value 0
  */
-register uint8_t display_status asm("r3");
-#define DISPLAY_BUFFER_LOCKED _BV(0)
-#define DISPLAY_BUFFER_ADVANCE _BV(1)
+volatile uint8_t display_status;
+#define DISPLAY_BUFFER_LOADING _BV(0)
+/*
+ * Has the display timer already counted the loading frame as late?
+ */
+volatile uint8_t display_frame_late;
 
-/**
- * This structure contains the display optimized values of the current image,
- * for one row.
- * pb - the values to apply for Port B
- * pc - the values to apply on Port C
- * pd - the values to apply for Port D
- * num_bit -  the number of bits in the current row
- * this is used for the bit correction.
- * If we light only one LED in a row it gets much brighter than if we display
- * all 8 LEDs in a row, since the internal resistance of the battery is that high.
- * (and the ATmega struggles to sink all the current).
- * Therefore we light up one LED shorter than 8 LEDs - called dot correction.
+/*
+ * The task which is activated at the end of each scan (the vertical sync),
+ * STATE_NONE if nobody is interested in it.
  */
-typedef struct
-{
-  uint8_t pb;
-  uint8_t pc;
-  uint8_t pd;
-  uint8_t num_bit;
-} display_line;
+uint8_t display_vsync_task = STATE_NONE;
 
 /*
- * This is the double buffer for the images:
- * 2 Buffers
+ * For measurements we track the longest time (in us) from the compare match
+ * of Timer 0 until the row routine is running. Since the timer starts at 0
+ * with each compare match its value is exactly this time.
+ * But if we are later than a whole period the timer has already started
+ * again and its value looks small. Then the compare flag is set again (it was
+ * cleared when the interrupt started) - such periods are counted as missed
+ * and the latency is stored as 255.
+ */
+volatile uint8_t display_max_latency;
+volatile uint16_t display_periods_missed;
+
+/*
+ * For measurements we count the frames which did not make it in time:
+ *  - late frames were still loading when the display needed them
+ *  - dropped frames did not fit in the ring anymore
+ */
+volatile uint16_t display_frames_late;
+volatile uint16_t display_frames_dropped;
+
+/*
+ * This is the ring buffer for the images:
+ * DISPLAY_FRAMES Buffers
  * each 8 rows.
  */
-display_line display_buffer[2][8];
+display_line display_buffer[DISPLAY_FRAMES][8];
+/*
+ * For each frame the list of rows with at least one lit LED, the bit plane
+ * unit of each of these rows and how many rows are in the list.
+ * An empty frame displays just row 0 (which is dark anyway).
+ */
+uint8_t display_rows[DISPLAY_FRAMES][8];
+uint8_t display_row_unit[DISPLAY_FRAMES][8];
+uint8_t display_row_count[DISPLAY_FRAMES];
 
 /*
  * This method initializes the display. It sets the output ports, loads the
@@ -135,124 +238,174 @@ display_init(void)
  * This routines loads an 8x8 bit matrix (8 bytes) into the internal buffer in
  * the format of the  display struct. The display struct contains all port
  * settings to increase the render speed.
- * The result is always written into the unused buffer.
- * While loading it is converted to direct bits for the ports. The number of
- * activated bits (=LEDs) is counted to enable some dot correction.
+ * The result is always written into the loading buffer.
  */
 void
 display_load_sprite(uint8_t origin[])
 {
-  //we select the next buffer by xoring either 0 or 1 with 1
-  uint8_t number = display_current_buffer ^ 1;
-  //lock the buffer to signal the display to wait with switching display buffers
-  //by that we got enough time to completely prepare the unused buffer.
-  display_status |= DISPLAY_BUFFER_LOCKED;
+  //we write to the loading buffer - it is never displayed
+  display_start_loading();
+  display_convert_sprite(display_buffer[display_load_buffer], origin);
+}
+
+/*
+ * This routine loads an 8x8 gray scale image into the loading buffer.
+ * The image consists of 32 bytes, 4 bytes for each row. Each byte contains the
+ * brightness (0 = off to 15 = full) of two LEDs: The lower nibble is the LED
+ * of the even column, the upper nibble the LED of the following odd column.
+ * The brightness values are split up into bit planes - one byte per row for
+ * each brightness bit. The display has less bit planes than 4 - so the
+ * lowest bits are dropped.
+ */
+void
+display_load_sprite_gray(uint8_t origin[])
+{
+  uint8_t number = display_load_buffer;
+  display_start_loading();
   uint8_t row;
   for (row = 0; row < 8; row++)
     {
-      //first we set all pins to low
-      uint8_t pb = 0;
-      uint8_t pc = 0;
-      uint8_t pd = 0;
-
-      //select the correct row
-      //this will switch on the row transistor
-      //bits 0 to 5 are set on the port c, bit 6-8
-      //is set on port c.
-      if (row < 6)
+      uint8_t planes[DISPLAY_BIT_PLANES] =
+        { 0 };
+      uint8_t column;
+      for (column = 0; column < 8; column++)
         {
-          pc |= _BV(row);
-        }
-      else
-        {
-          pb |= _BV(row) >> 6;
-        }
-      //calculate the number of active bits
-      //this is needed by the dot correction in display_render_row
-      display_buffer[number][row].num_bit = 0;
-      for (int i = 0; i < 8; i++)
-        {
-          if (origin[row] & _BV(i))
+          //select the nibble for this column
+          uint8_t value = origin[row * 4 + (column >> 1)];
+          if (column & 1)
             {
-              display_buffer[number][row].num_bit++;
+              value >>= 4;
+            }
+          //we display only the upper bits of the brightness
+          value = (value & 0xf) >> (4 - DISPLAY_BIT_PLANES);
+          //and distribute its bits to the bit planes
+          uint8_t plane;
+          for (plane = 0; plane < DISPLAY_BIT_PLANES; plane++)
+            {
+              if (value & _BV(plane))
+                {
+                  planes[plane] |= _BV(column);
+                }
             }
         }
-      //enable the drain for the selected lines
-      pd = origin[row];
+      display_convert_row(&display_buffer[number][row], row, planes);
+    }
+}
 
-      //save the calculated values to the sprite
-      display_buffer[number][row].pb = pb;
-      display_buffer[number][row].pc = pc;
-      display_buffer[number][row].pd = pd;
+/*
+ * Mark that a new frame is written to the loading buffer.
+ */
+void
+display_start_loading(void)
+{
+  display_frame_late = 0;
+  display_status |= DISPLAY_BUFFER_LOADING;
+}
+
+/*
+ * Build the list of rows of a frame, which need to be displayed at all.
+ */
+void
+display_list_rows(uint8_t number)
+{
+  uint8_t count = 0;
+  uint8_t row;
+  for (row = 0; row < 8; row++)
+    {
+      if (display_buffer[number][row].num_bit)
+        {
+          display_rows[number][count] = row;
+          count++;
+        }
     }
-  //unlock the buffer
-  display_status &= ~(DISPLAY_BUFFER_LOCKED);
+  if (count == 0)
+    {
+      display_rows[number][0] = 0;
+      display_row_unit[number][0] = DISPLAY_MAX_BCM_UNIT;
+      display_row_count[number] = 1;
+      return;
+    }
+  //now we know how many rows are displayed and can calculate the time for
+  //each row
+  uint8_t index;
+  for (index = 0; index < count; index++)
+    {
+      display_row_unit[number][index] = display_get_row_unit(count,
+          display_buffer[number][display_rows[number][index]].num_bit);
+    }
+  display_row_count[number] = count;
 }
 
 /*
- * Switch buffers.
- * This enables the rendering of the previously unused buffer (hopefully with
- * a new image) and frees the previously rendered buffer for writing to it.
+ * Put the loaded frame into the ring.
+ * The frame is displayed at least 'scans' times (one scan is a complete
+ * frame on the display - at most 3.6 ms) and as long as there is no following
+ * frame in the ring. Frames which are already waiting are displayed first.
+ * By that the renderer can render several frames in advance.
+ * If the ring is full the frame is dropped.
+ */
+void
+display_queue_buffer(uint8_t scans)
+{
+  uint8_t next = (display_load_buffer + 1) & (DISPLAY_FRAMES - 1);
+  display_status &= ~(DISPLAY_BUFFER_LOADING);
+  //if the next buffer is displayed there is no room in the ring
+  if (next == display_current_buffer)
+    {
+      display_frames_dropped++;
+      return;
+    }
+  display_frame_scans[display_load_buffer] = scans;
+  display_list_rows(display_load_buffer);
+  //ensure that the frame is completely written before the display timer
+  //can see it
+  __asm__ __volatile__ ("" ::: "memory");
+  display_load_buffer = next;
+}
+
+/*
+ * Display the loaded image next.
+ * The image is put into the ring and displayed after the frames waiting
+ * before it (at least for one scan).
  * The switching of the buffers is done by the display timer. Since only the
  * display timer knows when it does not need the buffer any longer.
  */
 void
 display_advance_buffer(void)
 {
-  //TODO don't we have to obey the display locked?
-  display_status |= DISPLAY_BUFFER_ADVANCE;
+  display_queue_buffer(1);
 }
 
 /*
- * Loads the test pattern.
+ * Set the task which is activated at the end of each scan - i.e. each time
+ * the display has shown a complete frame and could switch to the next frame.
  */
 void
-display_load_default_sequence(void)
+display_set_vsync_task(uint8_t task)
 {
-  uint8_t default_load_buffer[8] =
-    { 0, 0, 0, 0, 0, 0, 0, 0 };
-
-  display_current_buffer = 0;
-  copy_to_buffer(default_sprites[0], default_load_buffer);
-  display_load_sprite(default_load_buffer);
-  display_current_buffer = 1;
-  copy_to_buffer(default_sprites[1], default_load_buffer);
-  display_load_sprite(default_load_buffer);
-  display_current_buffer = 0;
+  display_vsync_task = task;
 }
 
 /*
- * Configures the row timer (Timer 0) at 13.9 kHz
- *
- * The estimated interrupt frequency
- *   F_OC = F_CPU/(prescaler*(OCR0A+1))
- *        = 8,000,000 Hz / (64 * (8+1))
- *        =  13,889 Hz (~14kHz)
- * results in a 'frame rate' of 13,339/8 = 1,736 FPS.
- * This _should_ be enough to prevent LED flicker.
- *
- * FPS rates below 1,000Hz will _definitely_ lead to POV
- * flicker effects! Test it for yourself by increasing
- * OCR0A to e.g. 17 (= 868 FPS, slight POV effects) or 35
- * (= 434 FPS, strong POV effects when shaking the device)
+ * Configures the row timer (Timer 0) for Binary Code Modulation
+ * (see DISPLAY_BCM_UNIT for the timing)
  */
-
 void
 display_start_row_timer(void)
 {
   power_timer0_enable();
   //setting Timer 0 to CTC mode
   TCCR0A = (1<<WGM01);
-  //setting prescaler to f_CPU/64
-  TCCR0B = (1<<CS01) | (1<<CS00);
+  //setting prescaler to f_CPU/8
+  TCCR0B = (1<<CS01);
   //Output Compare Interrupt Enable
   TIMSK0 = _BV(OCIE0A);
-  //setting TOP to 8
-  OCR0A = 8;
-
-
-
-
+  //setting TOP to the length of the first bit plane
+  OCR0A = DISPLAY_BCM_UNIT - 1;
+  //until the first frame is loaded we display the dark row 0 of the
+  //empty buffer
+  display_row_count[0] = 1;
+  display_row_unit[0][0] = DISPLAY_BCM_UNIT;
 }
 
 /*
@@ -260,55 +413,125 @@ display_start_row_timer(void)
  * This is the heart of the display routine. It is triggered every time Timer 0
  * hits OCR0A as upper limit.
  * The timer interrupt routine does the following:
- * - it renders the next row and increases the row counter
+ * - it renders the next lit row of the current bit plane and increases the
+ *   row counter
+ * - it sets the timer to the length of the bit plane for this row
  * - if needed it switches the display buffer
+ * - at the end of each scan it activates the vsync task
  * - it enables all the interrupts again
+ * Each plane is longer than the interrupt (see DISPLAY_MIN_BCM_UNIT) - so
+ * the interrupt is normally finished long before the plane ends.
+ * It returns how long the row is displayed (in us) - up to 256 us, so it does
+ * not fit into a byte.
  */
-void display_render_row(void)
+uint16_t display_render_row(void)
 {
   //we don't need to disable interrupts by ourself, because
   //inside ISRs interrupts are disabled by default
 
+  //how late are we?
+  uint8_t latency = TCNT0;
+  if (TIFR0 & _BV(OCF0A))
+    {
+      //a whole period late - the interrupt for the next period is already
+      //waiting, we throw it away since we start the next period right now
+      TIFR0 = _BV(OCF0A);
+      display_periods_missed++;
+      display_max_latency = 0xff;
+    }
+  else if (latency > display_max_latency)
+    {
+      display_max_latency = latency;
+    }
+
   //set all pins to 0 (switching everything off)
   PORTB = 0;
   PORTC = 0;
   PORTD = 0;
-  //we strip the first two bits - they are for dimming
-  //TODO do we get an 2 bit resolution too?
-  uint8_t display_row = display_curr_row & 7;
-  if ((display_curr_row & 8)
-      && !(display_buffer[display_current_buffer][display_row].num_bit & 0xFC))
+  //the lower 3 bits are the position in the row list, the upper bits the
+  //bit plane
+  uint8_t current = display_current_buffer;
+  uint8_t display_index = display_curr_row & 7;
+  uint8_t display_plane = display_curr_row >> 3;
+  //the bit plane is shown as long as its significance
+  //in CTC mode the new TOP value is used for the currently running period
+  uint8_t top = (display_row_unit[current][display_index] << display_plane) - 1;
+  OCR0A = top;
+  //the time until the next row is the time base for everything else
+  uint16_t period = (uint16_t) top + 1;
+  //if we were too late the timer has already passed the new TOP - instead
+  //of counting up to 255 and wrapping around we let it match right away
+  uint8_t now = TCNT0;
+  if (now >= top)
     {
-      //do nothing - disable
-      ;
-    }
-  else
-    {
-      //the set the ports line still off
-      PORTB = 0;
-      PORTC = 0;
-      PORTD = display_buffer[display_current_buffer][display_row].pd;
-      //the set the ports line enable
-      PORTB = display_buffer[display_current_buffer][display_row].pb;
-      PORTC = display_buffer[display_current_buffer][display_row].pc;
+      TCNT0 = top - 1;
+      period = (uint16_t) now + 2;
     }
+  display_line* line =
+      &display_buffer[current][display_rows[current][display_index]];
+  //the set the ports line still off
+  PORTD = line->pd[display_plane];
+  //the set the ports line enable
+  PORTB = line->pb;
+  PORTC = line->pc;
+  display_next_row();
 
-  //mask to max 8 + 2 dimming bits
+  //neither do we need to enable interrupts, as they will be
+  //automagically be enabled when returning from the ISR
+  return period;
+}
+
+/*
+ * Advance to the next row in the list - after the last row in the list
+ * start with the next bit plane. At the end of the scan the next frame is
+ * taken from the ring (if the current one was displayed long enough).
+ */
+void
+display_next_row(void)
+{
+  uint8_t current = display_current_buffer;
+  uint8_t display_index = display_curr_row & 7;
+  uint8_t display_plane = display_curr_row >> 3;
   display_curr_row++;
-  display_curr_row &= 0x1f;
+  if ((display_index + 1) >= display_row_count[current])
+    {
+      //after the last bit plane start again with the first one
+      display_plane++;
+      if (display_plane == DISPLAY_BIT_PLANES)
+        {
+          display_plane = 0;
+        }
+      display_curr_row = display_plane << 3;
+    }
 
   if (display_curr_row == 0)
     {
-      //if we reached the last row (and wrap) & we should advance to the next sprite display the next sprite
-      if ((display_status & (DISPLAY_BUFFER_LOCKED | DISPLAY_BUFFER_ADVANCE))
-          == DISPLAY_BUFFER_ADVANCE)
+      //if we reached the last row (and wrap) the frame is displayed once more
+      if (display_scans_left)
+        {
+          display_scans_left--;
+        }
+      //if it was displayed long enough we advance to the next frame in the ring
+      if (display_scans_left == 0)
+        {
+          uint8_t next = (display_current_buffer + 1) & (DISPLAY_FRAMES - 1);
+          if (next != display_load_buffer)
+            {
+              display_current_buffer = next;
+              display_scans_left = display_frame_scans[next];
+            }
+          //if there is no frame but the renderer is loading one it is late
+          else if ((display_status & DISPLAY_BUFFER_LOADING)
+              && !display_frame_late)
+            {
+              display_frame_late = 1;
+              display_frames_late++;
+            }
+        }
+      //signal the end of the scan
+      if (display_vsync_task != STATE_NONE)
         {
-          //advance one buffer
-          display_current_buffer = display_current_buffer ^ 1;
-          display_status &= ~(DISPLAY_BUFFER_ADVANCE);
+          state_activate(display_vsync_task);
         }
     }
-
-  //neither do we need to enable interrupts, as they will be
-  //automagically be enabled when returning from the ISR
 }
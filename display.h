@@ -24,6 +24,67 @@
 #ifndef DISPLAY_H_
 #define DISPLAY_H_
 
+//how many bits of brightness each LED has (0 = off to 7 = full)
+#define DISPLAY_BIT_PLANES 3
+
+/*
+ * The timing of the bit planes in timer ticks (1 us) - see display.c
+ * DISPLAY_BCM_UNIT is the time for the least significant bit plane if all 8
+ * rows are displayed, DISPLAY_MAX_BCM_UNIT and DISPLAY_MIN_BCM_UNIT limit the
+ * time if less rows are displayed or the dot correction is applied.
+ */
+#define DISPLAY_BCM_UNIT 64
+#define DISPLAY_MAX_BCM_UNIT 64
+#define DISPLAY_MIN_BCM_UNIT 32
+//a plane of unit u is displayed u, 2u, 4u ... ticks - 7u for 3 planes
+#define DISPLAY_PLANE_UNITS ((1 << DISPLAY_BIT_PLANES) - 1)
+#if (8 * DISPLAY_PLANE_UNITS * DISPLAY_BCM_UNIT) > 4000
+#error "DISPLAY_BCM_UNIT is too long, the display would flicker"
+#endif
+//the longest plane is 256 us: OCR0A = 255
+#if (DISPLAY_MAX_BCM_UNIT << (DISPLAY_BIT_PLANES - 1)) > 256
+#error "DISPLAY_MAX_BCM_UNIT does not fit into Timer 0"
+#endif
+/*
+ * The row interrupt itself takes time: DISPLAY_ISR_TICKS is an estimate of
+ * it (in us, about 200 cycles with both calls) - check it with a scope on a
+ * row pin and adjust it. Each plane must be longer than the interrupt,
+ * else the interrupt would be busy all the time.
+ */
+#define DISPLAY_ISR_TICKS 25
+#if DISPLAY_MIN_BCM_UNIT <= DISPLAY_ISR_TICKS
+#error "DISPLAY_MIN_BCM_UNIT must be longer than the interrupt"
+#endif
+
+//how many frames the display can buffer (must be a power of 2)
+//one frame is displayed, one is loaded & the rest is waiting to be displayed
+#define DISPLAY_FRAMES 4
+
+/**
+ * This structure contains the display optimized values of the current image,
+ * for one row.
+ * pb - the values to apply for Port B
+ * pc - the values to apply on Port C
+ * pd - the values to apply for Port D, one value for each bit plane. Plane 0
+ *      holds the least significant brightness bit of each LED of the row,
+ *      the last plane the most significant one. The display shows each
+ *      plane as long as its significance (Binary Code Modulation, see
+ *      display_render_row).
+ * num_bit -  the number of bits in the current row
+ * this is used for the bit correction.
+ * If we light only one LED in a row it gets much brighter than if we display
+ * all 8 LEDs in a row, since the internal resistance of the battery is that high.
+ * (and the ATmega struggles to sink all the current).
+ * Therefore we light up one LED shorter than 8 LEDs - called dot correction.
+ */
+typedef struct
+{
+  uint8_t pb;
+  uint8_t pc;
+  uint8_t pd[DISPLAY_BIT_PLANES];
+  uint8_t num_bit;
+} display_line;
+
 //sprite display
 void
 display_init(void);
@@ -32,12 +93,45 @@ display_init(void);
 void
 display_load_sprite(uint8_t origin[]);
 
+//render a gray scale sprite - 4 bit per LED, 32 bytes (the display shows
+//the upper DISPLAY_BIT_PLANES bits)
+void
+display_load_sprite_gray(uint8_t origin[]);
+
+//convert a sprite (or image) to the display format
+//this is in display-convert.c to be usable by the sprite converter too
+void
+display_convert_sprite(display_line lines[], uint8_t origin[]);
+
+//convert the bit planes of one row to the display format
+void
+display_convert_row(display_line* line, uint8_t row, uint8_t planes[]);
+
+//the bit plane unit for a row with num_bit LEDs if 'rows' rows are displayed
+uint8_t
+display_get_row_unit(uint8_t rows, uint8_t num_bit);
+
 //display the next sprite
 void
 display_advance_buffer(void);
 
-//the timer routine to render the next row
+//activate the given task at the end of each scan (vertical sync)
 void
+display_set_vsync_task(uint8_t task);
+
+//the longest time from the timer until the row was rendered (in us),
+//255 if a whole period was missed
+extern volatile uint8_t display_max_latency;
+//how often the row interrupt was later than a whole period
+extern volatile uint16_t display_periods_missed;
+
+//how many frames were late or did not fit in the display buffer
+extern volatile uint16_t display_frames_late;
+extern volatile uint16_t display_frames_dropped;
+
+//the timer routine to render the next row
+//returns the time until the next row (in us)
+uint16_t
 display_render_row(void);
 
 #endif /* DISPLAY_H_ */
@@ -0,0 +1,263 @@
+/*
+ * effects.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ * This file contains procedural effects. Instead of 8 bytes of flash for
+ * each sprite an effect calculates each image of its animation - so it never
+ * repeats and needs just a few bytes of flash.
+ * Each effect draws directly into the image of the animation. It gets the
+ * previous image of the animation back, so most effects simply change it.
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+//we need the standard integer types
+#include <stdint.h>
+//and memory routines
+#include <string.h>
+//we need some special register and tool definitions
+#include <avr/sfr_defs.h>
+//the lookup tables are stored in the flash
+#include <avr/pgmspace.h>
+
+//the effects are random
+#include "random.h"
+//and we need our own definitions
+#include "effects.h"
+
+/*
+ * The effects - each has a routine to start and a routine to draw the next
+ * image. The routines are in the order of the EFFECT_ numbers (starting with
+ * EFFECT_LIFE).
+ */
+void
+effect_life_start(uint8_t image[]);
+void
+effect_life_render(uint8_t image[]);
+void
+effect_clear(uint8_t image[]);
+void
+effect_rain_render(uint8_t image[]);
+void
+effect_fire_render(uint8_t image[]);
+void
+effect_plasma_start(uint8_t image[]);
+void
+effect_plasma_render(uint8_t image[]);
+
+const effect_callback effect_start_callbacks[] PROGMEM =
+  { effect_life_start, effect_clear, effect_clear, effect_plasma_start };
+const effect_callback effect_render_callbacks[] PROGMEM =
+  { effect_life_render, effect_rain_render, effect_fire_render,
+      effect_plasma_render };
+
+/*
+ * The game of life is calculated on all 64 cells at once: the image is used
+ * as one 64 bit number, a byte for each row. The neighbours of all cells are
+ * this number shifted in all 8 directions. The neighbours are counted in
+ * parallel for all cells with a counter of 3 bits, each bit in its own
+ * number. The display is a torus - what leaves it on one side enters it on
+ * the other.
+ * To detect if the game has stopped (nothing alive or a still life) or is
+ * blinking between two images we remember the previous generation.
+ */
+uint64_t effect_life_previous;
+
+/*
+ * Some drops for the rain - most of the time nothing, sometimes a drop.
+ */
+const prog_uint8_t effect_rain_drops[16] =
+  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x04, 0x10, 0x40,
+      0x02, 0x08, 0x20, 0x80 };
+
+/*
+ * The shape of the fire. The bottom row is always burning in the middle.
+ * A flame goes up if the row below is burning and - if it is not in the
+ * always burning columns of its row - by chance.
+ */
+#define EFFECT_FIRE_BASE 0x3c
+const prog_uint8_t effect_fire_keep[8] =
+  { 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x3c, 0x7e };
+
+/*
+ * A sine wave with 32 steps from 0 to 63 for the plasma. The plasma is the sum
+ * of 3 sine waves moving over the display, a pixel is on for every second
+ * band of the sum.
+ */
+const prog_uint8_t effect_plasma_sine[32] =
+  { 32, 38, 44, 49, 54, 58, 61, 62, 63, 62, 61, 58, 54, 49, 44, 38, 32, 25,
+      19, 14, 9, 5, 2, 1, 0, 1, 2, 5, 9, 14, 19, 25 };
+//how far the plasma has moved
+uint8_t effect_plasma_time;
+
+/*
+ * Start an effect.
+ */
+void
+effect_start(uint8_t effect, uint8_t image[])
+{
+  effect_callback callback = (effect_callback) pgm_read_word(
+      &effect_start_callbacks[effect - EFFECT_LIFE]);
+  callback(image);
+}
+
+/*
+ * Draw the next image of an effect.
+ */
+void
+effect_render(uint8_t effect, uint8_t image[])
+{
+  effect_callback callback = (effect_callback) pgm_read_word(
+      &effect_render_callbacks[effect - EFFECT_LIFE]);
+  callback(image);
+}
+
+/*
+ * Most effects start with an empty display.
+ */
+void
+effect_clear(uint8_t image[])
+{
+  memset(image, 0, 8);
+}
+
+/*
+ * Start the game of life with a random image.
+ */
+void
+effect_life_start(uint8_t image[])
+{
+  uint8_t row;
+  for (row = 0; row < 8; row++)
+    {
+      image[row] = get_random(256);
+    }
+  effect_life_previous = 0;
+}
+
+/*
+ * Calculate the next generation of the game of life.
+ */
+void
+effect_life_render(uint8_t image[])
+{
+  uint64_t cells;
+  memcpy(&cells, image, sizeof(cells));
+  //the neighbours to the left & right - each row is rotated by one bit
+  uint64_t left = ((cells << 1) & 0xfefefefefefefefeULL) | ((cells >> 7)
+      & 0x0101010101010101ULL);
+  uint64_t right = ((cells >> 1) & 0x7f7f7f7f7f7f7f7fULL) | ((cells << 7)
+      & 0x8080808080808080ULL);
+  uint64_t neighbours[8] =
+    { left, right, cells, left, right, cells, left, right };
+  //the 3 bits of the counter - if more than 3 neighbours are alive the cell
+  //is dead anyway, so the highest bit simply stays set
+  uint64_t count_0 = 0;
+  uint64_t count_1 = 0;
+  uint64_t count_4 = 0;
+  uint8_t neighbour;
+  for (neighbour = 0; neighbour < 8; neighbour++)
+    {
+      uint64_t add = neighbours[neighbour];
+      //the first three are the row above, then the row below, then this row
+      if (neighbour < 3)
+        {
+          add = (add << 8) | (add >> 56);
+        }
+      else if (neighbour < 6)
+        {
+          add = (add >> 8) | (add << 56);
+        }
+      uint64_t carry = count_0 & add;
+      count_0 ^= add;
+      count_4 |= count_1 & carry;
+      count_1 ^= carry;
+    }
+  //a cell lives with 3 neighbours, or with 2 if it is already alive
+  uint64_t next = ~count_4 & count_1 & (count_0 | cells);
+  //if the game has stopped we start again
+  if ((next == cells) || (next == effect_life_previous))
+    {
+      effect_life_start(image);
+      return;
+    }
+  effect_life_previous = cells;
+  memcpy(image, &next, sizeof(next));
+}
+
+/*
+ * The rain falls one row down and new drops start at the top.
+ */
+void
+effect_rain_render(uint8_t image[])
+{
+  memmove(image + 1, image, 7);
+  image[0] = pgm_read_byte(&effect_rain_drops[get_random(16)]);
+}
+
+/*
+ * The flames start at the bottom and burn upwards - by chance.
+ */
+void
+effect_fire_render(uint8_t image[])
+{
+  uint8_t row;
+  for (row = 0; row < 7; row++)
+    {
+      image[row] = image[row + 1] & (get_random(256) | pgm_read_byte(
+          &effect_fire_keep[row]));
+    }
+  image[7] = get_random(256) | EFFECT_FIRE_BASE;
+}
+
+/*
+ * The plasma starts somewhere.
+ */
+void
+effect_plasma_start(uint8_t image[])
+{
+  effect_plasma_time = get_random(32);
+}
+
+/*
+ * Move the 3 sine waves of the plasma: one horizontal, one vertical & one
+ * diagonal, all with different speed.
+ */
+void
+effect_plasma_render(uint8_t image[])
+{
+  uint8_t time = effect_plasma_time++;
+  uint8_t row;
+  for (row = 0; row < 8; row++)
+    {
+      uint8_t vertical = pgm_read_byte(&effect_plasma_sine[(row * 3 + time)
+          & 31]);
+      uint8_t pixels = 0;
+      uint8_t column;
+      for (column = 0; column < 8; column++)
+        {
+          uint8_t value = vertical + pgm_read_byte(
+              &effect_plasma_sine[(column * 2 + time * 2) & 31])
+              + pgm_read_byte(&effect_plasma_sine[(row + column + (time >> 1))
+                  & 31]);
+          if (value & 0x20)
+            {
+              pixels |= _BV(column);
+            }
+        }
+      image[row] = pixels;
+    }
+}
@@ -0,0 +1,51 @@
+/*
+ * effects.h
+ *
+ * This file contains procedural effects: instead of showing sprites from
+ * flash an effect calculates each image of the animation.
+ *
+ *  http://interactive-matter.eu/
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef EFFECTS_H_
+#define EFFECTS_H_
+
+/*
+ * The effects, to be used in the sequences (see custom-flash-content.c).
+ * EFFECT_NONE is a normal animation of sprites.
+ */
+#define EFFECT_NONE 0
+//Conway's game of life
+#define EFFECT_LIFE 1
+//rain drops falling down
+#define EFFECT_RAIN 2
+//flickering flames
+#define EFFECT_FIRE 3
+//moving plasma waves
+#define EFFECT_PLASMA 4
+
+//an effect draws the next image of its animation into image
+typedef void
+(*effect_callback)(uint8_t image[]);
+
+//start an effect - image is the image the effect is drawn into
+void effect_start(uint8_t effect, uint8_t image[]);
+//draw the next image of the effect - into the same image as before
+void effect_render(uint8_t effect, uint8_t image[]);
+
+#endif /* EFFECTS_H_ */
@@ -41,11 +41,30 @@
  * display.c/.h - routines to display images on the display. The low level
  *                display driver stuff like going through rows, mapping images
  *                to output pins & the display buffer.
+ * display-convert.c - converting images to the format of the display.
+ * sequence-frames.c/.h - the animations compressed to frame streams.
+ *                        sequence-frames.c is generated while compiling by
+ *                        the small program in tools/sequence-encode.c
+ * effects.c/.h - effects calculating animations instead of showing sprites,
+ *                like the game of life, rain, fire & plasma.
+ * transform.c/.h - rotating, mirroring & inverting images.
+ * transition.c/.h - wiping, sliding or dissolving from one image to the next.
+ * blit.c/.h - drawing sprites into images, to combine animations, texts and
+ *              other sprites.
+ * vm.c/.h - a tiny interpreter for animation programs with loops, texts &
+ *           effects. The programs are written in custom-programs.vm and
+ *           translated while compiling by tools/vm-assemble.c to vm-programs.c
  * random.c/.h - small random routine to state with a new animation every time
  *               the Blinken Button is switched on. And to randomly sequence
  *               animations and texts.
+ * storage.c/.h - remembering the random generator and the recently shown
+ *                animations in the EEPROM, to continue with new animations
+ *                after switching off.
+ * shuffle.c/.h - showing animations and texts in random order, but each one
+ *                once before the next round.
  * state.c/.h - a small helper routine to remember what needs to be done or is
  *              going on in order to do the right thing at the right time.
+ * timer.c/.h - software timers calling routines periodically.
  *
  * If you want to tinker with the animations, images and texts have a look in
  * the file 'custom-flash-content.c'. There you can change or create new text
@@ -56,7 +75,8 @@
  * magic to select texts and messages and decide when to display what.
  *
  * If you want to see how the images that are calculated in 'rendering.c' are
- * displayed check 'display.c'. There you will find a double buffer, routines
+ * displayed check 'display.c'. There you will find a ring of frame buffers
+ * (the renderer puts frames in, the display timer takes them out), routines
  * to write to the buffers and routines to display the buffers on the LED matrix
  *
  * You can safely ignore the files 'state.c' and 'random.c'
@@ -71,12 +91,15 @@
  *   single rows of the display. It cycles through row 0 to 7, switches the
  *   row on and enables the correct LEDs. By cycling through this sequence really
  *   fast the human eye assembles all those rows to a complete image
- * - Timer 2 is responsible for building animations from single images.
- *   It controls the timing when the displayed image is switched and when a new
- *   image needs to be loaded.
+ * - All other timing is done by software timers (see timer.c), which count
+ *   the time of Timer 0. They are responsible for building animations from
+ *   single images. They control the timing when the displayed image is
+ *   switched and when a new image needs to be loaded. Timer 1 & Timer 2 are
+ *   not needed and switched off (Timer 1 only measures the watchdog for the
+ *   random seed at the start).
  *
  * The main loop is implemented using so called states. Since the main loop is completely
- * controlled  by Timer 2 it has a 'state' which is activated when a new image is displayed
+ * controlled by the timers it has a 'state' which is activated when a new image is displayed
  * an the net animation needs to be loaded.
  * Therefore you will only find the cryptic 'process_state' in the main routine.
  */
@@ -93,12 +116,14 @@
 #include <avr/interrupt.h>
 
 // state manages the triggering of calculations
-// according to Timer 2
+// according to the timers
 #include "state.h"
 // animations.c contains all routines for rendering the animations from single images
 #include "rendering.h"
 // display.c is responsible for rendering the images on the display.
 #include "display.h"
+// timer.c contains the software timers
+#include "timer.h"
 
 /*
  * This is the main routine. The main routine gets executed when the ATmega powers up.
@@ -114,6 +139,8 @@ main(void)
    * So here we switch anything of like UART, ADC, timers and so on.
    */
   power_all_disable();
+  //the software timers are needed by everyone
+  timer_init();
   //now start the animations
   animation_init();
 
@@ -135,23 +162,28 @@ main(void)
        * by state_process we check if a new image has to be loaded and call the load routine
        */
       state_process();
+      /*
+       * if there is nothing to do we sleep until the next interrupt to save
+       * the battery
+       */
+      state_sleep();
     }
 }
 
-//timer 0 controls the row rendering
+/*
+ * timer 0 controls the row rendering
+ * and is the time base for all other timers
+ * This is the only interrupt we use (besides the watchdog once at the start,
+ * see random.c). Anything that takes some time (loading
+ * sprites or sequences, rendering text) is done in tasks (see state.h) - here
+ * we only display the row, count the time & activate the tasks. Outside of
+ * this interrupt only very short blocks disable the interrupts. So the row
+ * is always displayed in time - check display_max_latency.
+ */
 ISR(TIMER0_COMPA_vect )
 {
-  display_render_row();
-}
-
-//timer 1 is used to decide what to display
-ISR (TIMER1_OVF_vect)
-{
-  aimation_update();
-}
-
-//timer 2 is used to switch between the different images of an animation or text
-ISR(TIMER2_OVF_vect)
-{
-  animation_switch_sprite();
+  uint16_t us = display_render_row();
+  timer_count_us(us);
+  //and measure how much we sleep
+  state_count_tick(us);
 }
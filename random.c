@@ -22,39 +22,182 @@
  */
 //include the definitions for our chip, like pins, ports & so on
 #include <stdio.h>
+#include <avr/io.h>
+//the jitter is measured in the watchdog interrupt
+#include <avr/interrupt.h>
+//the watchdog must be changed without being interrupted
+#include <util/atomic.h>
+//we power up & down chip components as needed, here are the functions to do this
+#include <avr/power.h>
 
 //include our own definitions
 #include "random.h"
 
-static uint32_t RandomSeedA = 65537;
-static uint32_t RandomSeedB = 12345;
+//how many bytes of uninitialized ram are used for the seed
+#define RANDOM_NOINIT_SIZE 32
 
+/*
+ * The state of the random generator: two 16 bit words of a xorshift
+ * generator. It may be anything but both 0 - then it only gives zeroes.
+ */
+uint16_t random_x = 12345;
+uint16_t random_y = 65521;
+
+/*
+ * Here we prototype some private functions we only need in this module.
+ */
+//calculate the next 16 random bits
+uint16_t
+random_next(void);
+
+/*
+ * Some ram which is not initialized at startup. After switching on it
+ * contains whatever the memory cells decided to be, after a reset what was
+ * left there. We write the new seed back, so even a reset gives a new seed.
+ */
+uint8_t random_noinit[RANDOM_NOINIT_SIZE] __attribute__ ((section (".noinit")));
 
 /*
- * To randomize the seed we simply read add up all memory content.
+ * To randomize the seed we mix the uninitialized ram into it.
  * This is no very good random routine. I would not use it for crypto stuff
  * (where you need real randomness) but the memory content is random enough to
  * start with a new animation each time.
  * To generate a good randomness it is useful to do this as early as possible
  * in the startup. Since after startup some bits in the memory can be flipped
  * by accident.
+ * Each byte is mixed in with a handful of shifts & adds (the 'one at a time'
+ * hash) - that are about 32 * 120 cycles, so the seed is ready after less
+ * than 0.5 ms. The old routine added up the whole 64K address space, which
+ * took about 40 ms before anything was displayed.
+ * Additionally we measure how long the watchdog oscillator needs for its
+ * shortest period (about 16 ms) with Timer 1 counting the cpu clock. Both
+ * clocks are independent & drift with voltage and temperature, so the lower
+ * bits of the count are pretty random. This is done in the background by the
+ * watchdog interrupt - it is mixed in long before the first sequence is
+ * selected at the end of the test pattern. The interrupts stay as they are:
+ * main() enables them when everything is initialized, if the watchdog is
+ * faster the interrupt just waits until then.
  */
 void
 randomize_seed(void)
 {
- 	uint16_t *addr = 0;
-	for (addr = 0; addr < (uint16_t*)0xFFFF; addr++)
-		RandomSeedB += (*addr);
+  //start with the saved state (see storage.c)
+  uint32_t hash = ((uint32_t) random_y << 16) | random_x;
+  uint8_t i;
+  for (i = 0; i < RANDOM_NOINIT_SIZE; i++)
+    {
+      hash += random_noinit[i];
+      hash += hash << 10;
+      hash ^= hash >> 6;
+    }
+  hash += hash << 3;
+  hash ^= hash >> 11;
+  hash += hash << 15;
+  //a seed of 0 would only give zeroes
+  if (hash != 0)
+    {
+      random_x = hash;
+      random_y = hash >> 16;
+    }
+  //the next start gets another seed
+  for (i = 0; i < sizeof(hash); i++)
+    {
+      random_noinit[i] ^= hash >> (i * 8);
+    }
+
+  //start counting the cpu clock
+  power_timer1_enable();
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  TCNT1 = 0;
+  //and let the watchdog interrupt us after its shortest period
+  //(the second write must follow within 4 cycles)
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      MCUSR &= ~_BV(WDRF);
+      WDTCSR = _BV(WDCE) | _BV(WDE);
+      WDTCSR = _BV(WDIE);
+    }
+}
+
+/*
+ * The watchdog period is over - mix the jitter of Timer 1 into the seed and
+ * switch both off again.
+ */
+ISR(WDT_vect)
+{
+  random_x ^= TCNT1;
+  if ((random_x == 0) && (random_y == 0))
+    {
+      random_y = 1;
+    }
+  WDTCSR = 0;
+  TCCR1B = 0;
+  power_timer1_disable();
+}
+
+/*
+ * Get the state of the random generator, e.g. to save it.
+ */
+void
+random_get_state(uint16_t state[])
+{
+  state[0] = random_x;
+  state[1] = random_y;
+}
+
+/*
+ * Continue with a saved state of the random generator.
+ */
+void
+random_set_state(const uint16_t state[])
+{
+  //a state of 0 would only give zeroes
+  if ((state[0] != 0) || (state[1] != 0))
+    {
+      random_x = state[0];
+      random_y = state[1];
+    }
+}
+
+/*
+ * This calculates the next 16 random bits.
+ * It is a xorshift generator with two 16 bit words (shifts 5, 3 & 1), so it
+ * only needs 16 bit shifts and xors - no multiplication at all. It repeats
+ * after 2^32 - 1 numbers (checked on the pc by running it that long).
+ */
+uint16_t
+random_next(void)
+{
+  uint16_t t = random_x ^ (random_x << 5);
+  random_x = random_y;
+  random_y = (random_y ^ (random_y >> 1)) ^ (t ^ (t >> 3));
+  return random_y;
 }
 
 /*
- * This generates a new random number of maximum 'max'
+ * This generates a new random number of maximum 'max' (0 to max - 1).
+ * Instead of the remainder of a division (which is very slow on the AVR) the
+ * random bits are scaled to the range by a multiplication: the upper half of
+ * random * max is evenly spread between 0 and max - 1 (a little less evenly
+ * than a division, since max rarely divides 2^16 - but you won't see that).
+ * Small ranges (the most common) are scaled by two 8 x 8 bit multiplications
+ * instead of a 16 x 16 bit one.
+ * Estimated cycles on the AVR: about 40 for ranges up to 255, about 60 for
+ * larger ones. The previous multiply with carry generator needed two 32 bit
+ * multiplications and a 32 bit division - about 800 cycles.
  */
 unsigned int
 get_random(unsigned int max)
 {
-  	RandomSeedA = 36969 * (RandomSeedA & 65535) + (RandomSeedA >> 16);
-	RandomSeedB = 18000 * (RandomSeedB & 65535) + (RandomSeedB >> 16);
- 	return ((RandomSeedA << 16) + RandomSeedB) % max;
+  uint16_t random = random_next();
+  if (max <= 0xff)
+    {
+      //the same as (random * max) >> 16
+      uint16_t high = (uint8_t) (random >> 8) * (uint8_t) max;
+      uint16_t low = (uint8_t) random * (uint8_t) max;
+      return (high + (low >> 8)) >> 8;
+    }
+  return ((uint32_t) random * max) >> 16;
 }
 
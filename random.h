@@ -25,15 +25,23 @@
 #define RANDOM_H_
 
 /*
- * To randomize the seed we simply read add up all memory content.
+ * To randomize the seed we mix the uninitialized ram and the jitter of the
+ * watchdog into it.
  * To generate a god randomness it is useful to do this as early as possible
  * in the startup.
  */
 void randomize_seed(void);
 
 /*
- * This generates a new random number of maximum 'max'
+ * This generates a new random number of maximum 'max' (0 to max - 1)
  */
 unsigned int get_random(unsigned int max);
 
+/*
+ * The state of the random generator are two 16 bit words. It can be saved and
+ * restored to continue with the same random numbers later.
+ */
+void random_get_state(uint16_t state[]);
+void random_set_state(const uint16_t state[]);
+
 #endif /* RANDOM_H_ */
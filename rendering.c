@@ -50,27 +50,98 @@
 #include "random.h"
 //and we need our display
 #include "display.h"
+//and the compressed animations
+#include "sequence-frames.h"
+//and the effects, calculating animations
+#include "effects.h"
+//and the transformations of sprites
+#include "transform.h"
+//and the transitions between sequences
+#include "transition.h"
+//the layers are combined by the blitter
+#include "blit.h"
+//the timing is done by software timers
+#include "timer.h"
+//sequences can be programs
+#include "vm.h"
+//the recently shown sequences are remembered in the EEPROM
+#include "storage.h"
+//sequences & messages can be shuffled
+#include "shuffle.h"
 
 /*
- * The defines the speed text scrolls through the display
- * Increase for slower scrolling, decrease for faster scrolling
- * TODO this is a wait time - is there a way to rework this?
+ * How often the text is scrolled (in ms). The speed of the text does not
+ * depend on it - in each tick the text moves as far as its speed says, even
+ * if that is only a part of a column.
  */
-#define TEXT_SCROLL_SPEED 2
+#define TEXT_SCROLL_TICK 10
 /*
- * This defines the internal size of the animation buffer.
- * It contains several images of an animation in the main ram.
- * TODO get rid of this!
+ * One column in the unit of the scroll position: the speed is in 1/256
+ * columns per second and is added each ms
  */
-#define BUFFER_SIZE 8
+#define TEXT_SCROLL_COLUMN (256UL * 1000UL)
+/*
+ * How fast the dot of the test pattern moves (in ms per step)
+ */
+#define TEST_PATTERN_SPEED 33
+/*
+ * How often we decide what to display next (in ms). The display length of
+ * the sequences is counted in this unit - so it is in seconds.
+ */
+#define ANIMATION_UPDATE_PERIOD 1000
+/*
+ * How long each step of a transition between two sequences is shown (in ms)
+ */
+#define TRANSITION_SPEED 40
 
 /*
- * Our main display buffer to load sprites into. To make size comparisons easier
- * we allocate it one array bigger. Else we would have to use clumpsy
- * BUFFER_SIZE+1 calculation all through the code.
- * TODO get rid of this!
+ * How often we try to select a sequence which was not shown recently - after
+ * that we take what we get (there may be less sequences than the history).
+ */
+#define SEQUENCE_SELECT_TRIES 4
+
+/*
+ * How much ram the shuffle bags may use (see shuffle.h). The sequences are in
+ * the bag as often as their weight - if they do not fit they are selected
+ * randomly instead.
+ */
+#define SEQUENCE_BAG_SIZE 16
+#define MESSAGE_BAG_SIZE 8
+/*
+ * The image for animations, effects & the test pattern. It is rendered in the
+ * main ram and converted for the display.
+ */
+uint8_t animation_image[8];
+/*
+ * The display shows several layers, combined by the blitter before the
+ * image is converted for the display:
+ * - the animation (animation_image)
+ * - the text (text_image) - either replacing the animation or as ticker over
+ *   the running animation (see text_mode)
+ * - an overlay sprite, placed anywhere on the display
+ * animation_frame is the combined image, which was displayed last.
+ */
+uint8_t animation_frame[8];
+uint8_t text_image[8];
+const uint8_t* animation_overlay;
+int8_t animation_overlay_x;
+int8_t animation_overlay_y;
+uint8_t animation_overlay_mode;
+/*
+ * The font is 6 rows high and drawn to the rows 2 to 7 of the display
  */
-uint8_t animations_buffer[BUFFER_SIZE + 1][8];
+#define TEXT_ROWS 6
+#define TEXT_FIRST_ROW 2
+/*
+ * The text is rasterized character by character into a strip of columns - a
+ * byte for each column with a bit for each row, just like in the font. Each
+ * character has at most 3 columns + an empty column.
+ * Scrolling is just moving an 8 column window over the text: shift the
+ * display one column to the left and add the next column of the strip. If
+ * the strip is used up the next character is rasterized.
+ */
+#define TEXT_STRIP_COLUMNS 4
+uint8_t text_strip[TEXT_STRIP_COLUMNS];
 
 /*
  * State for displaying text & animations.
@@ -78,34 +149,45 @@ uint8_t animations_buffer[BUFFER_SIZE + 1][8];
  * - displaying animations
  * - displaying texts
  * - do we need to render some text
- * - is the text finished and we fill the remaining space
  * - do we need to load a new sequence from flash
  * - do we need to load a new sprite from flash
  */
 //are we displaying text?
 volatile uint8_t state_animation_displaying_text;
+//are we displaying text as ticker over the animation?
+volatile uint8_t state_animation_displaying_ticker;
 //are we displaying animations?
 volatile uint8_t state_animation_displaying_animation;
 //is some rendering needed?
 volatile uint8_t state_animation_text_render_state;
-//are we displaying text outro?
-volatile uint8_t state_animation_display_text_outro;
 //is a new sequence needed?
 volatile uint8_t state_animation_next_sequence;
-//do we need to load the next sprite?
-volatile uint8_t state_animation_next_sprite;
+//the next instruction of the program is due
+volatile uint8_t state_animation_program;
 //this state is used to play an simple test pattern at the beginning
 volatile uint8_t state_animation_test_pattern;
+//the display has finished a scan
+volatile uint8_t state_animation_vsync;
 
 /*
- * wait time to switch to the next sprite
- * */
-volatile uint8_t animation_sprite_wait = 0;
+ * The timers for switching to the next sprite and for deciding what to
+ * display next.
+ */
+uint8_t animation_sprite_timer;
+uint8_t animation_update_timer;
+//and the timer to scroll the text
+uint8_t animation_text_timer;
+/*
+ * Is the next sprite due? Only used if the animations are locked to the
+ * display - then the sprite is rendered at the next vsync.
+ */
+volatile uint8_t animation_frame_due;
 /*
- * The display speed of the current sequence
- * This is set to 255. Each animation has it own animation speed later
+ * The display speed of the current sequence (in ms per sprite)
+ * This starts with the speed of the test pattern. Each animation has it own
+ * animation speed later
  */
-volatile uint8_t animation_sprite_speed = 255;
+uint16_t animation_sprite_speed = TEST_PATTERN_SPEED;
 /*
  * How fast do we want to change to the next sequence.
  * This controls how fast we switch between the different animations and text.
@@ -117,57 +199,118 @@ volatile uint8_t switch_sequence_interval;
  * to the next sequence.
  */
 volatile uint8_t switch_sequence_wait;
-//begin index of the current sequence
-volatile uint8_t animation_sequence_start;
-//end index of the current sequence
-volatile uint8_t animation_sequence_end;
-//the index of the next sprite to be displayed
-volatile uint8_t animation_sequence_next_sprite;
+/*
+ * The sequence player only remembers where the current sequence is in flash
+ * and which sprite of it comes next. Each sprite is decoded from the
+ * compressed frame stream (see sequence-frames.h) into animation_image when
+ * it is due. So a sequence can be as long as you want and needs no ram for
+ * its sprites.
+ * If the sequence is an effect each sprite is calculated by the effect.
+ */
+//the effect of the current sequence - EFFECT_NONE for animations
+uint8_t animation_effect;
+//is the current sequence a program (see vm.h)?
+uint8_t animation_program;
+//the recently shown sequences, the newest first
+uint8_t animation_history[STORAGE_HISTORY];
+//the shuffle bags for the sequences & messages
+uint8_t animation_sequence_items[SEQUENCE_BAG_SIZE];
+shuffle_bag animation_sequence_bag;
+uint8_t animation_message_items[MESSAGE_BAG_SIZE];
+shuffle_bag animation_message_bag;
+//the frame stream of the current sequence
+const prog_uint8_t* animation_sequence;
+//the next operation in the frame stream
+const prog_uint8_t* animation_sequence_position;
+//how many sprites the current frame is still shown
+uint8_t animation_sequence_repeat;
+/*
+ * The transition to a new sequence. The last image of the previous sequence
+ * (or text) is blended with the first image of the new sequence in
+ * TRANSITION_STEPS steps. After the last step the transition is finished.
+ */
+uint8_t animation_transition_from[8];
+uint8_t animation_transition_image[8];
+uint8_t animation_transition_step = TRANSITION_STEPS;
 //buffer for the above values
 //needed if we want to display text in between
-uint8_t animation_buffer_sequence_start;
-uint8_t animation_buffer_sequence_end;
-uint8_t animation_buffer_sequence_speed;
+const prog_uint8_t* animation_buffer_sequence;
+uint8_t animation_buffer_effect;
+uint8_t animation_buffer_program;
+uint16_t animation_buffer_sequence_speed;
 
 /*
  * variables for displaying messages.
  * Basically
- *  msg_buffer holds the pointer to the actual message
- *  message_length is the length of the currently displayed message
- *  message_pointer points to the currently displayed character of the message
- *  message_char_pointer is the current position in the character, currently
- *   displayed (i.e. going from 0 to 3 for a 4 column character)
- *  message_char_length is the length of the currently displayed char
- *  message_active_char holds the numerical value of the current character to
- *   read it from flash memory
- */
-char* msg_buffer;
-uint8_t message_length;
-uint8_t message_pointer;
-uint8_t message_char_pointer;
-uint8_t message_char_length;
-uint8_t message_active_char;
+ *  text_source points to the next character of the message. The message is
+ *   read directly from flash or ram (if text_source_flash is 0) - it is
+ *   never copied. The message ends with a 0, so it can be as long as you want
+ *  text_position is the next column of the strip to display
+ *  text_length is the number of columns in the strip
+ *  text_outro is the number of empty columns after the end of the message
+ *  text_speed is the speed of the message (see ANIMATION_TEXT_SPEED)
+ *  text_mode is how the text is drawn over the animation (see blit.h),
+ *   BLIT_REPLACE hides the animation
+ *  text_scroll is how far the text has moved to the next column (in
+ *   TEXT_SCROLL_COLUMN units)
+ */
+const char* text_source;
+uint8_t text_source_flash;
+uint8_t text_position;
+uint8_t text_length;
+uint8_t text_outro;
+uint16_t text_speed;
+uint8_t text_mode;
+uint32_t text_scroll;
+//how many seconds no message was displayed
+uint8_t text_wait;
 
 /*
  * This are prototypes for functions we use in this file but we do not want to
  * make them accessible for others - since they are internal
  */
-//start the timer for switching between animations
+//the sprite timer - it is time for the next sprite
 void
-animation_start_animation_timer(void);
-//start the timer for updating sequences or text
+animation_next_frame(void);
+//display a message of messages[]
 void
-animation_start_update_timer(void);
-//internal routing to set sequence
-//with this routine you can overwrite the built in sprites
+animation_load_message_number(uint8_t number);
+//select the next sequence
+uint8_t
+animation_select_sequence(void);
+//fill the shuffle bags
 void
-animation_set_sequence(int8_t start, int8_t end, uint8_t speed);
-//clear the animation buffer
+animation_fill_bags(void);
+//execute the next instruction of the program
+uint8_t
+animation_execute_program(void);
+//clear the image for text & test pattern
 void
-animation_clear_buffer(uint8_t buffer_number);
-
+animation_clear_image(void);
+//display the image of the animation
+void
+animation_load_image(void);
+//combine the layers & display them
+void
+animation_show_layers(const uint8_t background[]);
+//the text timer - it is time to scroll the text
+void
+animation_next_text(void);
+//start displaying the message in text_source
+void
+animation_start_message(void);
+//read the next character of the message
+char
+animation_read_char(void);
+//rasterize the next character into the text strip
 void
-animation_show_char(void);
+animation_rasterize_char(void);
+//scroll the text one column
+void
+animation_scroll_column(void);
+//scroll the text one column
+void
+animation_show_text(void);
 //finish displaying a message and go back to animation
 void
 animation_end_display_message(void);
@@ -180,6 +323,18 @@ animation_load_next_sequence(void);
 //load the next sprite from flash memory
 void
 animation_load_next_sprite(void);
+//start displaying the current sequence with a certain speed
+void
+animation_start_sequence(uint16_t speed);
+//decode or calculate the next sprite into the image
+uint8_t
+animation_render_next_sprite(void);
+//start a transition from the current image
+void
+animation_start_transition(void);
+//display the next step of the transition
+void
+animation_show_transition(void);
 
 /*
  * This functions set up everything for the animation routine. It needs to be
@@ -188,19 +343,31 @@ animation_load_next_sprite(void);
 void
 animation_init(void)
 {
-  //get a new random seed
+  //continue where we stopped last time
+  if (!storage_init(animation_history))
+    {
+      //nothing was shown yet
+      memset(animation_history, 0xff, sizeof(animation_history));
+    }
+  //and get a new random seed
   randomize_seed();
+  animation_fill_bags();
 
   //register the states
   state_animation_text_render_state
-      = state_register_task(animation_text_render);
-  state_animation_next_sprite = state_register_task(animation_load_next_sprite);
+      = state_register_task(animation_text_render, STATE_PRIORITY_TEXT);
   state_animation_next_sequence = state_register_task(
-      animation_load_next_sequence);
+      animation_load_next_sequence, STATE_PRIORITY_SEQUENCE);
+  state_animation_program = state_register_task(animation_load_next_sprite,
+      STATE_PRIORITY_PROGRAM);
   state_animation_displaying_text = state_register_state();
+  state_animation_displaying_ticker = state_register_state();
   state_animation_displaying_animation = state_register_state();
-  state_animation_display_text_outro = state_register_state();
   state_animation_test_pattern = state_register_state();
+#ifdef ANIMATION_FRAME_LOCK
+  state_animation_vsync = state_register_task(animation_vsync,
+      STATE_PRIORITY_VSYNC);
+#endif
 
   //before we do anything we switch on the test pattern
   state_activate(state_animation_test_pattern);
@@ -209,9 +376,13 @@ animation_init(void)
   display_init();
   //and now start the display
   //start the update timer for switching animations
-  animation_start_update_timer();
-  //start the timer to change sequences
-  animation_start_animation_timer();
+  animation_update_timer = timer_register(aimation_update,
+      ANIMATION_UPDATE_PERIOD);
+  //start the timer to change sprites
+  animation_sprite_timer = timer_register(animation_next_frame,
+      animation_sprite_speed);
+  //the timer to scroll texts runs only while a text is displayed
+  animation_text_timer = timer_register(animation_next_text, TIMER_STOPPED);
 }
 
 //routine to advance one sequence
@@ -220,58 +391,305 @@ animation_load_next_sequence(void)
 {
 
   //select the next sequence randomly
-  uint8_t animation_sequence_number = get_random(max_sequence);
+  uint8_t animation_sequence_number = animation_select_sequence();
   //buffer for loading a sequence (all information for the sequence)
   //like length and so on
   _sequence_struct curr_sequence;
   //copy the sequence from flash to the buffer in the previous line
   memcpy_P(&curr_sequence, &sequences[animation_sequence_number],
       sizeof(_sequence_struct));
-  //how many sprites we got in the sequence
-  uint8_t sequence_length = pgm_read_byte(curr_sequence.sprites);
-  //load the sprites
-  uint8_t i;
-  for (i = 0; i < sequence_length; i++)
+  //now set the sequence a s currently displayed sequence
+  if (curr_sequence.program != 0)
     {
-      uint8_t index = pgm_read_byte(curr_sequence.sprites+i + 1);
-      copy_to_buffer(predefined_sprites[index], animations_buffer[i]);
+      const prog_uint8_t* program = (const prog_uint8_t*) pgm_read_word(
+          &vm_programs[curr_sequence.program - 1]);
+      animation_set_program(program, curr_sequence.display_speed);
+    }
+  else if (curr_sequence.effect != EFFECT_NONE)
+    {
+      animation_set_effect(curr_sequence.effect, curr_sequence.display_speed);
+    }
+  else
+    {
+      //the compressed frames of the sequence stay in flash
+      const prog_uint8_t* frames = (const prog_uint8_t*) pgm_read_word(
+          &sequence_frames[animation_sequence_number]);
+      animation_set_sequence(frames, curr_sequence.display_speed);
     }
-  uint8_t speed = curr_sequence.display_speed;
-  //now set the sequence a s currently displayed sequence
-  animation_set_sequence(0, sequence_length - 1, speed);
   //set the sequence display length
   switch_sequence_interval = curr_sequence.display_length;
+  //remember the new sequence, even when we are switched off
+  memmove(animation_history + 1, animation_history,
+      sizeof(animation_history) - 1);
+  animation_history[0] = animation_sequence_number;
+  storage_save(animation_history);
+}
+
+/*
+ * Put the sequences & messages into their shuffle bags - if they should be
+ * shuffled and they fit.
+ */
+void
+animation_fill_bags(void)
+{
+  uint8_t size = 0;
+  uint8_t number;
+  if (sequence_playlist == PLAYLIST_SHUFFLE)
+    {
+      for (number = 0; number < max_sequence; number++)
+        {
+          uint8_t weight = pgm_read_byte(&sequences[number].weight);
+          while (weight > 0)
+            {
+              if (size == SEQUENCE_BAG_SIZE)
+                {
+                  //too many - stay random
+                  size = 0;
+                  number = max_sequence;
+                  break;
+                }
+              animation_sequence_items[size] = number;
+              size++;
+              weight--;
+            }
+        }
+    }
+  shuffle_init(&animation_sequence_bag, animation_sequence_items, size);
+  //do not start with the sequence shown before switching off
+  shuffle_set_last(&animation_sequence_bag, animation_history[0]);
+  size = 0;
+  if ((message_playlist == PLAYLIST_SHUFFLE) && (max_messages
+      <= MESSAGE_BAG_SIZE))
+    {
+      for (size = 0; size < max_messages; size++)
+        {
+          animation_message_items[size] = size;
+        }
+    }
+  shuffle_init(&animation_message_bag, animation_message_items, size);
 }
+
 /*
- * This routine loads the next sprite from flash to load it into the display
+ * Select the next sequence - the next of the shuffle bag, or randomly
+ * according to the weights but not one of the recently shown sequences, if
+ * possible.
+ * The upper byte of the random number selects the column of the alias table
+ * (see sequence-frames.h), the lower byte decides between the sequence and
+ * its alias.
+ */
+uint8_t
+animation_select_sequence(void)
+{
+  uint8_t number;
+  uint8_t tries = SEQUENCE_SELECT_TRIES;
+  if (animation_sequence_bag.size > 0)
+    {
+      return shuffle_next(&animation_sequence_bag);
+    }
+  for (;;)
+    {
+      uint16_t random = get_random(max_sequence << 8);
+      number = random >> 8;
+      if ((uint8_t) random >= pgm_read_byte(&sequence_alias[number].threshold))
+        {
+          number = pgm_read_byte(&sequence_alias[number].alias);
+        }
+      tries--;
+      if ((tries == 0) || (memchr(animation_history, number,
+          sizeof(animation_history)) == NULL))
+        {
+          return number;
+        }
+    }
+}
+/*
+ * This routine loads the next sprite of the sequence into the display.
  */
 void
 animation_load_next_sprite(void)
 {
-  //we load the next sprite to the display
-  display_load_sprite(animations_buffer[animation_sequence_next_sprite]);
+  if (animation_render_next_sprite())
+    {
+      animation_load_image();
+    }
+}
+
+/*
+ * This routine decodes the next sprite of the sequence from flash into the
+ * image. It decodes one operation of the frame stream at most - so it never
+ * takes longer than the end of the stream and a key frame.
+ * Returns 0 if the sprite is the same as before.
+ */
+uint8_t
+animation_render_next_sprite(void)
+{
+  //programs draw the next sprite themselves
+  if (animation_program)
+    {
+      return animation_execute_program();
+    }
+  //effects calculate the next sprite
+  if (animation_effect != EFFECT_NONE)
+    {
+      effect_render(animation_effect, animation_image);
+      return 1;
+    }
+  //if the current frame is repeated the display simply keeps it
+  if (animation_sequence_repeat > 0)
+    {
+      animation_sequence_repeat--;
+      return 0;
+    }
+  uint8_t operation = pgm_read_byte(animation_sequence_position++);
+  //at the end we start again from the beginning
+  if (operation == FRAME_END)
+    {
+      animation_sequence_position = animation_sequence;
+      operation = pgm_read_byte(animation_sequence_position++);
+    }
+  if ((operation & FRAME_TRANSFORM) == FRAME_TRANSFORM)
+    {
+      //the same frame - just rotated, mirrored or something like that
+      transform_image(operation & ~FRAME_TRANSFORM, animation_image);
+    }
+  else if (operation & FRAME_KEY)
+    {
+      //a complete new frame
+      memcpy_P(animation_image, animation_sequence_position, 8);
+      animation_sequence_position += 8;
+    }
+  else if (operation & FRAME_DELTA)
+    {
+      //only the changed rows are stored
+      uint8_t mask = pgm_read_byte(animation_sequence_position++);
+      uint8_t row;
+      for (row = 0; row < 8; row++)
+        {
+          if (mask & _BV(row))
+            {
+              animation_image[row]
+                  ^= pgm_read_byte(animation_sequence_position++);
+            }
+        }
+    }
+  else
+    {
+      //this sprite is already on the display, only count the remaining ones
+      animation_sequence_repeat = operation - 1;
+      return 0;
+    }
+  return 1;
+}
+
+/*
+ * This routine executes the next instruction of the program and does what
+ * the program wants.
+ * Returns 0 if the image has not changed.
+ */
+uint8_t
+animation_execute_program(void)
+{
+  uint8_t result = vm_execute();
+  if (result & VM_RESULT_SPEED)
+    {
+      animation_sprite_speed = vm_speed;
+      //a transition keeps its own speed until it is finished
+      if (animation_transition_step >= TRANSITION_STEPS)
+        {
+          timer_set_period(animation_sprite_timer, animation_sprite_speed);
+        }
+    }
+  if ((result & VM_RESULT_TEXT) && (vm_text < max_messages))
+    {
+      animation_load_message_number(vm_text);
+    }
+  if (result & VM_RESULT_END)
+    {
+      //the program is finished - so is the sequence
+      switch_sequence_wait = 0;
+      state_activate(state_animation_next_sequence);
+    }
+  return result & VM_RESULT_SHOW;
+}
+
+/*
+ * This routine loads the image of the animation with all other layers into
+ * the display
+ */
+void
+animation_load_image(void)
+{
+  //during a transition the animation is the current step of the transition
+  if ((animation_transition_step > 0) && (animation_transition_step
+      < TRANSITION_STEPS))
+    {
+      animation_show_layers(animation_transition_image);
+    }
+  else
+    {
+      animation_show_layers(animation_image);
+    }
+}
+
+/*
+ * This routine combines the layers on top of the background (the animation)
+ * and loads them into the display.
+ */
+void
+animation_show_layers(const uint8_t background[])
+{
+  memcpy(animation_frame, background, sizeof(animation_frame));
+  if (state_is_active(state_animation_displaying_text)
+      || state_is_active(state_animation_displaying_ticker))
+    {
+      blit_sprite(animation_frame, text_image, 0, 0, text_mode);
+    }
+  if (animation_overlay != NULL)
+    {
+      blit_sprite(animation_frame, animation_overlay, animation_overlay_x,
+          animation_overlay_y, animation_overlay_mode);
+    }
+  //the image has to be converted
+  display_load_sprite(animation_frame);
   //and switch to it
   display_advance_buffer();
 }
 
+/*
+ * This routine sets the overlay sprite, drawn over animations & texts.
+ *  sprite is the sprite (in ram) - NULL removes the overlay
+ *  x, y is the position of its top left corner (-7 to 7)
+ *  mode is how it is drawn (see blit.h)
+ * The overlay is displayed with the next image.
+ */
+void
+animation_set_overlay(const uint8_t* sprite, int8_t x, int8_t y, uint8_t mode)
+{
+  animation_overlay = sprite;
+  animation_overlay_x = x;
+  animation_overlay_y = y;
+  animation_overlay_mode = mode;
+}
+
 /*
  * This routine sets the current sequence.
- *  start is in respect of the internal buffer
- *  end as well
- *  speed is the wait time for the sprites - and by that controlling the speed
- *   of the animation
+ *  frames is the frame stream of the sequence in flash (see
+ *   sequence-frames.h), it has to start with a key frame
+ *  speed is the display time for each sprite (in ms) - and by that
+ *   controlling the speed of the animation
  */
 void
-animation_set_sequence(int8_t start, int8_t end, uint8_t speed)
+animation_set_sequence(const uint8_t* frames, uint16_t speed)
 {
-  if ((start < BUFFER_SIZE) && (end < BUFFER_SIZE) && (start <= end))
+  if (pgm_read_byte(frames) == FRAME_KEY)
     {
-      animation_sequence_start = start;
-      animation_sequence_end = end;
-      animation_sequence_next_sprite = start;
-      animation_sprite_speed = speed;
-      state_activate(state_animation_displaying_animation);
-      state_deactivate(state_animation_displaying_text);
+      animation_start_transition();
+      animation_effect = EFFECT_NONE;
+      animation_program = 0;
+      animation_sequence = frames;
+      animation_sequence_position = frames;
+      animation_sequence_repeat = 0;
+      animation_start_sequence(speed);
     }
   else
     {
@@ -280,45 +698,186 @@ animation_set_sequence(int8_t start, int8_t end, uint8_t speed)
 }
 
 /*
- * select a message from flash memory to load it into the internal message
- * buffer
+ * This routine sets an effect as current sequence.
+ *  effect is the effect (see effects.h)
+ *  speed is the display time for each sprite (in ms)
+ */
+void
+animation_set_effect(uint8_t effect, uint16_t speed)
+{
+  animation_start_transition();
+  animation_effect = effect;
+  animation_program = 0;
+  effect_start(effect, animation_image);
+  animation_start_sequence(speed);
+}
+
+/*
+ * This routine sets a program (see vm.h) as current sequence.
+ *  program is the program in flash
+ *  speed is the display time for each sprite (in ms) - until the program
+ *   sets its own speed
+ */
+void
+animation_set_program(const uint8_t* program, uint16_t speed)
+{
+  animation_start_transition();
+  animation_effect = EFFECT_NONE;
+  animation_program = 1;
+  vm_start(program, animation_image);
+  animation_start_sequence(speed);
+}
+
+/*
+ * This routine starts displaying the current sequence.
+ */
+void
+animation_start_sequence(uint16_t speed)
+{
+  animation_sprite_speed = speed;
+  //the sequence starts with the transition
+  timer_set_period(animation_sprite_timer, TRANSITION_SPEED);
+  state_activate(state_animation_displaying_animation);
+  state_deactivate(state_animation_displaying_text);
+}
+
+/*
+ * This routine starts a transition from the image currently displayed to the
+ * first sprite of the next sequence.
+ */
+void
+animation_start_transition(void)
+{
+  //start from what was displayed last
+  memcpy(animation_transition_from, animation_frame,
+      sizeof(animation_transition_from));
+  transition_start(get_random(TRANSITION_COUNT));
+  animation_transition_step = 0;
+}
+
+/*
+ * This routine displays the next step of the transition. Each step takes
+ * about as long as loading a sprite.
+ */
+void
+animation_show_transition(void)
+{
+  //the first step gets the first sprite of the new sequence
+  if (animation_transition_step == 0)
+    {
+      animation_render_next_sprite();
+    }
+  animation_transition_step++;
+  transition_render(animation_transition_step, animation_transition_from,
+      animation_image, animation_transition_image);
+  animation_load_image();
+  //after the last step the sequence continues with its own speed
+  if (animation_transition_step == TRANSITION_STEPS)
+    {
+      timer_set_period(animation_sprite_timer, animation_sprite_speed);
+    }
+}
+
+/*
+ * select a message from flash memory and display it - directly from flash
  */
 void
 animation_load_message(void)
 {
-  uint8_t animation_message_number = get_random(max_messages);
-  strcpy_P(message,
-      (char*) pgm_read_word(&(messages[animation_message_number])));
+  if (animation_message_bag.size > 0)
+    {
+      animation_load_message_number(shuffle_next(&animation_message_bag));
+    }
+  else
+    {
+      animation_load_message_number(get_random(max_messages));
+    }
 }
 
 /*
- * Display a certain message.
- * This is done by switching of the animation, switching to 'text mode'.
- * Saving the current animation to later come back to it after we have
- * finished displaying the text
+ * display the message 'number' of messages[]
  */
 void
-animation_display_message(char* message)
+animation_load_message_number(uint8_t number)
 {
-  //set status
-  state_activate(state_animation_displaying_text);
-  state_deactivate(state_animation_displaying_animation);
+  //buffer for the message (the text stays in flash)
+  _message_struct curr_message;
+  memcpy_P(&curr_message, &messages[number], sizeof(_message_struct));
+  animation_display_message_P(curr_message.text, curr_message.scroll_speed,
+      curr_message.mode);
+}
 
-  //save the previous animation
-  animation_buffer_sequence_start = animation_sequence_start;
-  animation_buffer_sequence_end = animation_sequence_end;
-  animation_buffer_sequence_speed = animation_sprite_speed;
+/*
+ * Display a certain message from ram.
+ * The message is not copied - so it has to stay until it is displayed.
+ *  speed is the speed of the text (see ANIMATION_TEXT_SPEED)
+ *  mode is how the text is drawn over the animation (see blit.h), with
+ *   BLIT_REPLACE the animation is stopped until the text is finished
+ */
+void
+animation_display_message(char* message, uint16_t speed, uint8_t mode)
+{
+  text_source = message;
+  text_source_flash = 0;
+  text_speed = speed;
+  text_mode = mode;
+  animation_start_message();
+}
 
-  //TODO copy message to some internal buffer?
-  msg_buffer = message;
-  message_length = strlen(msg_buffer);
-  message_pointer = 0;
-  message_char_pointer = 0;
-  message_char_length = 0;
-  animation_sprite_speed = TEXT_SCROLL_SPEED;
+/*
+ * Display a certain message from flash.
+ *  speed is the speed of the text (see ANIMATION_TEXT_SPEED)
+ *  mode is how the text is drawn over the animation (see blit.h)
+ */
+void
+animation_display_message_P(const char* message, uint16_t speed, uint8_t mode)
+{
+  text_source = message;
+  text_source_flash = 1;
+  text_speed = speed;
+  text_mode = mode;
+  animation_start_message();
+}
 
-  //to ensure a clean buffer we clear the text buffer
-  animation_clear_buffer(BUFFER_SIZE);
+/*
+ * Start to display the message in text_source.
+ * If the text replaces the animation this is done by switching of the
+ * animation, switching to 'text mode'. Saving the current animation to later
+ * come back to it after we have finished displaying the text.
+ * Else the text is displayed as ticker over the running animation.
+ */
+void
+animation_start_message(void)
+{
+  if (text_mode == BLIT_REPLACE)
+    {
+      //set status
+      state_activate(state_animation_displaying_text);
+      state_deactivate(state_animation_displaying_animation);
+
+      //save the previous animation
+      animation_buffer_sequence = animation_sequence;
+      animation_buffer_effect = animation_effect;
+      animation_buffer_program = animation_program;
+      animation_buffer_sequence_speed = animation_sprite_speed;
+    }
+  else
+    {
+      state_activate(state_animation_displaying_ticker);
+    }
+
+  //the next message is due after this one
+  text_wait = 0;
+  //the strip is empty, so the first character is rasterized right away
+  text_position = 0;
+  text_length = 0;
+  text_outro = 0;
+  //the first column is shown with the first tick
+  text_scroll = TEXT_SCROLL_COLUMN;
+  timer_set_period(animation_text_timer, TEXT_SCROLL_TICK);
+
+  //to ensure a clean display we clear the text image
+  memset(text_image, 0, sizeof(text_image));
 
   state_activate(state_animation_text_render_state);
 }
@@ -331,10 +890,29 @@ animation_display_message(char* message)
 void
 animation_end_display_message(void)
 {
+  //no need to wake up for scrolling until the next text
+  timer_set_period(animation_text_timer, TIMER_STOPPED);
+  //a ticker is simply removed from the running animation
+  if (state_is_active(state_animation_displaying_ticker))
+    {
+      state_deactivate(state_animation_displaying_ticker);
+      animation_load_image();
+      return;
+    }
   //restore the previous animation
   //the status is updated by set_Sequence
-  animation_set_sequence(animation_buffer_sequence_start,
-      animation_buffer_sequence_end, animation_buffer_sequence_speed);
+  //the text is only a layer over the animation image - so programs and
+  //effects simply continue after the text with their image
+  if (animation_buffer_program || (animation_buffer_effect != EFFECT_NONE))
+    {
+      animation_start_transition();
+      animation_start_sequence(animation_buffer_sequence_speed);
+    }
+  else
+    {
+      animation_set_sequence(animation_buffer_sequence,
+          animation_buffer_sequence_speed);
+    }
   //the built in buffer was used for rendering the text
   //load_default_sequence();
   //set status
@@ -342,83 +920,121 @@ animation_end_display_message(void)
   state_activate(state_animation_displaying_animation);
 }
 
+/*
+ * Reads the next character of the message from flash or ram. At the end of
+ * the message it stays at the terminating 0.
+ */
+char
+animation_read_char(void)
+{
+  char character;
+  if (text_source_flash)
+    {
+      character = pgm_read_byte(text_source);
+    }
+  else
+    {
+      character = *text_source;
+    }
+  if (character != 0)
+    {
+      text_source++;
+    }
+  return character;
+}
+
+/*
+ * Rasterizes the next character of the message into the text strip. At the
+ * end of the message the strip stays empty.
+ */
+void
+animation_rasterize_char(void)
+{
+  text_position = 0;
+  text_length = 0;
+  char message_char = animation_read_char();
+  if (message_char == 0)
+    {
+      return;
+    }
+  // which character is displayed
+  uint8_t character = (message_char - CHAR_OFFSET) * 4;
+  //how much columns got the current char
+  uint8_t char_length = pgm_read_byte(&font[character + 3]);
+  uint8_t char_column;
+  for (char_column = 0; char_column < char_length; char_column++)
+    {
+      // read pixels for current column of char
+      text_strip[text_length] = pgm_read_byte(&font[character + char_column]);
+      text_length++;
+    }
+  //an empty column between the chars
+  text_strip[text_length] = 0;
+  text_length++;
+}
+
 /*
  * Displays the actual message.
- * Scrolls the screen to the left and draws new pixels for the current character
- * on the right.
+ * Moves the text as far as it got since the last tick - and scrolls it one
+ * column for each column it got.
  */
 void
-animation_show_char(void)
+animation_show_text(void)
 {
-  uint8_t i;
+  uint8_t scrolled = 0;
+  text_scroll += (uint32_t) text_speed * TEXT_SCROLL_TICK;
+  while ((text_scroll >= TEXT_SCROLL_COLUMN) && (text_outro < 8))
+    {
+      text_scroll -= TEXT_SCROLL_COLUMN;
+      animation_scroll_column();
+      scrolled = 1;
+    }
+  if (!scrolled)
+    {
+      return;
+    }
+  //and now combine the text with the animation & display it
+  animation_load_image();
+  //ok, we are really finished if the text has left the display
+  if (text_outro == 8)
+    {
+      animation_end_display_message();
+    }
+}
 
-  // shift the screen to the left
-  for (i = 0; i < 8; i++)
+/*
+ * Scrolls the screen to the left and draws the next column of the text strip
+ * on the right. This takes the same time for each column - only if a new
+ * character is started its 3 columns are read from the font.
+ */
+void
+animation_scroll_column(void)
+{
+  uint8_t column = 0;
+  if (text_position == text_length)
     {
-      animations_buffer[BUFFER_SIZE][i] >>= 1;
+      animation_rasterize_char();
     }
-  //if we reached the end of the previous char
-  // advance a char if needed
-  if (message_char_pointer == message_char_length)
+  if (text_position < text_length)
     {
-      //a unusual char length of 0
-      //signals the first run
-      if (message_char_length != 0)
-        {
-          message_pointer++;
-        }
-      if (message_pointer == message_length)
-        {
-          state_activate(state_animation_display_text_outro);
-        }
-      // which character is displayed
-      message_active_char = msg_buffer[message_pointer] - CHAR_OFFSET;
-      //how much columns got the current char
-      message_char_length = pgm_read_byte(&font[message_active_char * 4 + 3]);
-      //start at the beginning of the char
-      message_char_pointer = 0;
+      column = text_strip[text_position];
+      text_position++;
     }
   else
     {
-      //advance to the next char column
-      if (!state_is_active(state_animation_display_text_outro))
-        {
-          uint8_t char_byte;
-          // read pixels for current column of char
-          char_byte
-              = pgm_read_byte(font+(message_active_char * 4 + message_char_pointer));
-          message_char_pointer++;
-          // write pixels into screen memory
-          for (i = 0; i < 6; i++)
-            {
-              if (char_byte & _BV(i))
-                {
-                  animations_buffer[BUFFER_SIZE][i + 2] |= _BV(7);
-                }
-            }
-        }
-      //if we are displaying the outro just add empty columns
-      else
+      //after the text we scroll in empty columns until the text is gone
+      text_outro++;
+    }
+  uint8_t row;
+  for (row = TEXT_FIRST_ROW; row < TEXT_FIRST_ROW + TEXT_ROWS; row++)
+    {
+      text_image[row] >>= 1;
+      if (column & 1)
         {
-          //if we have not reached 8 empty columns
-          if (message_char_pointer < 8)
-            {
-              message_char_pointer++;
-            }
-          else
-          //ok, we are really finished
-            {
-              state_deactivate(state_animation_display_text_outro);
-              animation_end_display_message();
-            }
+          text_image[row] |= _BV(7);
         }
+      column >>= 1;
     }
-  //load the rendered text part into the main display buffer
-  display_load_sprite(animations_buffer[BUFFER_SIZE]);
-  //we start at the first sprite
-  animation_sequence_next_sprite = BUFFER_SIZE;
-  //and now display this sprite
-  animation_load_next_sprite();
 }
 
 /*
@@ -430,66 +1046,37 @@ void
 animation_text_render(void)
 {
   //if we are displaying text advance on char
-  if (state_is_active(state_animation_displaying_text))
+  if (state_is_active(state_animation_displaying_text)
+      || state_is_active(state_animation_displaying_ticker))
     {
-      //we use alternating the first two sprites of the buffer
-      animation_show_char();
+      animation_show_text();
     }
   else //if we are not displaying a text message
     {
-      //according to a random value we decide if we want to display some text
-      if (get_random(message_probability) == 1)
+      //we are called once a second - after some seconds comes the next text
+      text_wait++;
+      if (text_wait >= message_interval)
         {
           animation_load_message();
-          animation_display_message(message);
         }
     }
 }
 
 /*
- * A small routine to write 8 zeroes to the buffer.
- */
-void
-animation_clear_buffer(uint8_t buffer_number)
-{
-  if (buffer_number < BUFFER_SIZE)
-    {
-      animations_buffer[buffer_number][0] = 0;
-      animations_buffer[buffer_number][1] = 0;
-      animations_buffer[buffer_number][2] = 0;
-      animations_buffer[buffer_number][3] = 0;
-      animations_buffer[buffer_number][4] = 0;
-      animations_buffer[buffer_number][5] = 0;
-      animations_buffer[buffer_number][6] = 0;
-      animations_buffer[buffer_number][7] = 0;
-    }
-  else
-    {
-      //TODO error handling
-    }
-}
-
-/*
- * This routine starts the update timer (Timer 1). it is used to switch between
- * animations. The timer runs at 0,4Hz (it is a 16 bit counter) to switch
- * smoothly between the animations.
- * TODO can't we unite those timers - they confuse me
+ * A small routine to write 8 zeroes to the image.
  */
 void
-animation_start_update_timer(void)
+animation_clear_image(void)
 {
-  power_timer1_enable();
-  TCCR1A = 0;
-  TCCR1B = _BV(CS12);
-  TCCR1C = 0;
-  TIMSK1 = _BV(TOIE1);
+  memset(animation_image, 0, sizeof(animation_image));
 }
 
 volatile uint8_t test_row = 0;
 volatile uint8_t test_column = 0;
 
 /*
- * And this is the real code for Timer1
+ * This is the update timer. It is used to switch between animations. It runs
+ * every ANIMATION_UPDATE_PERIOD ms to switch smoothly between the animations.
  */
 void aimation_update(void)
 {
@@ -511,29 +1098,53 @@ void aimation_update(void)
           state_activate(state_animation_next_sequence);
         }
     }
-  //we render the text anyway
-  //this function also decides if there should be some text displayed
-  state_activate(state_animation_text_render_state);
+  //if no text is displayed the text rendering decides if there should be
+  //some text displayed - a displayed text is only moved by the text timer
+  if (!state_is_active(state_animation_displaying_text)
+      && !state_is_active(state_animation_displaying_ticker))
+    {
+      state_activate(state_animation_text_render_state);
+    }
+
+}
 
+/*
+ * This is the sprite timer. It is called each time the next sprite is due.
+ * If the animations are locked to the display we wait for the next vsync to
+ * render it, else we render it right away.
+ */
+void
+animation_next_frame(void)
+{
+#ifdef ANIMATION_FRAME_LOCK
+  animation_frame_due = 1;
+  display_set_vsync_task(state_animation_vsync);
+#else
+  animation_switch_sprite();
+#endif
 }
 
 /*
- * This is the 'animation timer' it switches between the different images of
- * the animation to produce the animation sequence. It runs at 30Hz
+ * This is called after a scan of the display, if the animations are locked to
+ * the display and a new sprite is due. So the sprite is displayed with the
+ * next scan - always less than one scan (at most 3.6 ms) after rendering it.
  */
 void
-animation_start_animation_timer(void)
+animation_vsync(void)
 {
-  power_timer2_enable();
-  TCCR2A = 0;
-  TCCR2B = _BV(CS22) | _BV(CS21) | _BV(CS20);
-  TIMSK2 = _BV(TOIE2);
-  ASSR = 0;
+  //we only need the next vsync
+  display_set_vsync_task(STATE_NONE);
+  if (animation_frame_due)
+    {
+      animation_frame_due = 0;
+      animation_switch_sprite();
+    }
 }
 
 /*
- * This is the actual timer routine which controls switching from one sprite
- * to the other in a regular manner.
+ * This is the actual routine which controls switching from one sprite
+ * to the other in a regular manner. It is called by the sprite timer each
+ * time the next sprite is due.
  */
 void
 animation_switch_sprite(void)
@@ -541,14 +1152,12 @@ animation_switch_sprite(void)
   if (state_is_active(state_animation_test_pattern))
     {
       //we simply let a dot go from top left to bottom right
-      //so we first clear the buffer
-      animation_clear_buffer(0);
+      //so we first clear the image
+      animation_clear_image();
       //then we enable the dot in the current column & row
-      animations_buffer[0][test_row] = _BV(test_column);
+      animation_image[test_row] = _BV(test_column);
       //load it immediately to the display
-      display_load_sprite(animations_buffer[0]);
-      //and switch the buffer
-      display_advance_buffer();
+      animation_load_image();
       //on to thenext column
       test_column++;
       //if we reached the last column
@@ -561,52 +1170,45 @@ animation_switch_sprite(void)
           //and if we even reached the last row - we can end the test pattern
           if (test_row >= 8)
             {
-              //We leave the buffer in a proper state
-              animation_clear_buffer(0);
+              //We leave the image in a proper state
+              animation_clear_image();
               //and deactivate our test state an go over to 'normal' operation
               state_deactivate(state_animation_test_pattern);
-              //prepare to load the first sequence
-              animation_load_next_sequence();
-              //load the first sprite immediately
-              animation_load_next_sprite();
+              //the first sequence is loaded by its own task - the first
+              //sprite of it is displayed with the next call
+              state_activate(state_animation_next_sequence);
             }
         }
       return;
     }
-  //we should not wait any longer
-  if (animation_sprite_wait == 0)
+  if (state_is_active(state_animation_displaying_animation))
     {
-      if (state_is_active(state_animation_displaying_animation))
+      if (animation_transition_step < TRANSITION_STEPS)
         {
-          //if we are not in the current sequence switch to start
-          if (animation_sequence_next_sprite < animation_sequence_start)
-            {
-              animation_sequence_next_sprite = animation_sequence_start;
-            }
-          else
-            {
-              //advance one sprite
-              animation_sequence_next_sprite++;
-              //if we reached the end of the sequence
-              if (animation_sequence_next_sprite > animation_sequence_end)
-                {
-                  //start again from the beginning
-                  animation_sequence_next_sprite = animation_sequence_start;
-                }
-            }
-          state_activate(state_animation_next_sprite);
+          animation_show_transition();
         }
-      //if we are displaying text initiate a new render cycle
-      else if (state_is_active(state_animation_displaying_text))
+      else if (animation_program)
         {
-          state_activate(state_animation_text_render_state);
+          //the interpreter runs as its own task
+          state_activate(state_animation_program);
+        }
+      else
+        {
+          animation_load_next_sprite();
         }
-      //set the wait variable to the current wait time
-      animation_sprite_wait = animation_sprite_speed;
     }
-  else
-  //wait a bit less
+}
+
+/*
+ * This is the text timer. If we are displaying text initiate a new render
+ * cycle.
+ */
+void
+animation_next_text(void)
+{
+  if (state_is_active(state_animation_displaying_text)
+      || state_is_active(state_animation_displaying_ticker))
     {
-      animation_sprite_wait--;
+      state_activate(state_animation_text_render_state);
     }
 }
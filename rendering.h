@@ -27,14 +27,37 @@
 #ifndef ANIMATION_H_
 #define ANIMATION_H_
 
+/*
+ * If this is defined the animations are locked to the display: Each image of
+ * an animation is rendered right after the display has finished a scan (a scan
+ * is a complete frame on the display, at most 3.6 ms). By that the time from
+ * rendering to displaying an image is always less than one scan.
+ * If it is not defined the images are rendered as soon as they are due.
+ */
+#define ANIMATION_FRAME_LOCK
+
 //initialization routine
 void animation_init(void);
-//render text
-void animation_display_message(char* message);
+//render text from ram or flash - the text is read while it is displayed
+//the speed is in 1/256 columns per second (see ANIMATION_TEXT_SPEED)
+//the mode is how the text is drawn over the animation (see blit.h)
+void animation_display_message(char* message, uint16_t speed, uint8_t mode);
+void animation_display_message_P(const char* message, uint16_t speed,
+    uint8_t mode);
+//draw a sprite over everything else (see blit.h), NULL removes it
+void animation_set_overlay(const uint8_t* sprite, int8_t x, int8_t y,
+    uint8_t mode);
 //animate a sequence of sprites (images) to form an animation
-void animation_set_sequence(int8_t start, int8_t end, uint8_t speed);
-//the routine for the animation timer to change animations & display texts
+//the frames are a compressed frame stream in flash (see sequence-frames.h)
+void animation_set_sequence(const uint8_t* frames, uint16_t speed);
+//animate an effect (see effects.h) instead of sprites
+void animation_set_effect(uint8_t effect, uint16_t speed);
+//run a program (see vm.h) instead of a sequence
+void animation_set_program(const uint8_t* program, uint16_t speed);
+//the routine for the sprite timer to change animations & display texts
 void animation_switch_sprite(void);
+//the routine called at the end of a scan of the display
+void animation_vsync(void);
 //the routine to switch between different animations & texts - used by the update timer
 void aimation_update(void);
 
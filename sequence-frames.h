@@ -0,0 +1,67 @@
+/*
+ * sequence-frames.h
+ *
+ *  http://interactive-matter.eu/
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SEQUENCE_FRAMES_H_
+#define SEQUENCE_FRAMES_H_
+
+/*
+ * The animations of the sequences in custom-flash-content.c as compressed
+ * frame streams. sequence-frames.c is generated by tools/sequence-encode
+ * while building - so just edit the sprites & sequences in the flash content
+ * files and everything else is done by make.
+ *
+ * A frame stream is a list of operations, one for each sprite of the
+ * animation. Each operation starts with a byte:
+ *  FRAME_KEY - the 8 rows of the frame follow
+ *  FRAME_DELTA - a byte follows, with a bit for each row that changed (bit 0
+ *    is row 0), followed by the XOR of the old and new row for each changed row
+ *  FRAME_TRANSFORM + a transformation (see transform.h) - the current frame is
+ *    transformed, e.g. mirrored or inverted
+ *  1 to FRAME_MAX_REPEAT - the current frame is shown that many sprites long
+ *  FRAME_END - the end of the stream, start again with the first operation
+ * The first operation of a stream is always a key frame. So decoding a sprite
+ * never takes more than the end, a key frame and 9 bytes.
+ */
+#define FRAME_END 0x00
+#define FRAME_MAX_REPEAT 0x3f
+#define FRAME_KEY 0x40
+#define FRAME_DELTA 0x80
+#define FRAME_TRANSFORM 0xc0
+
+//the frame streams, in the same order as sequences[] (0 for effects)
+extern const prog_uint8_t* const sequence_frames[] PROGMEM;
+
+/*
+ * The alias table to select the sequences according to their weight (with
+ * Walker's alias method). Take a random sequence & a random byte: if the byte
+ * is below the threshold of the sequence take it, else take its alias.
+ * So a weighted selection is one random number and one comparison.
+ */
+typedef struct
+{
+  uint8_t threshold;
+  uint8_t alias;
+} _alias_struct;
+
+//the alias table, in the same order as sequences[]
+extern const _alias_struct sequence_alias[] PROGMEM;
+
+#endif /* SEQUENCE_FRAMES_H_ */
@@ -0,0 +1,99 @@
+/*
+ * shuffle.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ * This file contains a shuffle bag (see shuffle.h).
+ * The bag is shuffled while drawing (Fisher-Yates): a random item of the
+ * remaining ones is swapped to the end of the remaining items and is not
+ * drawn again in this round. So the drawn items are collected at the end of
+ * the list - when all are drawn the next round simply starts with the whole
+ * list again. Nothing needs to be copied and each draw is one random number.
+ * The next round never starts with the item which ended the last one (if the
+ * bag has anything else), so no item is shown twice in a row.
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+//we need the standard integer types
+#include <stdint.h>
+
+//we draw randomly
+#include "random.h"
+//and we need our own definitions
+#include "shuffle.h"
+
+/*
+ * Start a bag. The items must already be in 'items'. Nothing was drawn yet -
+ * use shuffle_set_last if the item shown last is known.
+ */
+void
+shuffle_init(shuffle_bag* bag, uint8_t items[], uint8_t size)
+{
+  bag->items = items;
+  bag->size = size;
+  bag->remaining = size;
+  bag->last = 0xff;
+}
+
+/*
+ * Tell the bag which item was drawn last (e.g. before the last power off) -
+ * it is not drawn again next.
+ */
+void
+shuffle_set_last(shuffle_bag* bag, uint8_t item)
+{
+  bag->last = item;
+}
+
+/*
+ * Draw the next item of the bag.
+ */
+uint8_t
+shuffle_next(shuffle_bag* bag)
+{
+  //all drawn - start the next round
+  if (bag->remaining == 0)
+    {
+      bag->remaining = bag->size;
+    }
+  //an item can be several times in the bag - so the copies of the item drawn
+  //last are moved to the end of the remaining items and we draw only from
+  //the others (if any are left in this round). Each of them has the same
+  //chance.
+  uint8_t others = bag->remaining;
+  uint8_t index = 0;
+  while (index < others)
+    {
+      if (bag->items[index] == bag->last)
+        {
+          others--;
+          bag->items[index] = bag->items[others];
+          bag->items[others] = bag->last;
+        }
+      else
+        {
+          index++;
+        }
+    }
+  uint8_t draw = get_random((others > 0) ? others : bag->remaining);
+  //swap it behind the remaining items
+  bag->remaining--;
+  uint8_t item = bag->items[draw];
+  bag->items[draw] = bag->items[bag->remaining];
+  bag->items[bag->remaining] = item;
+  bag->last = item;
+  return item;
+}
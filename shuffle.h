@@ -0,0 +1,52 @@
+/*
+ * shuffle.h
+ *
+ * This file contains a shuffle bag: it draws the items of a list in random
+ * order, but each item only once - until all are drawn and the next round
+ * starts.
+ *
+ *  http://interactive-matter.eu/
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHUFFLE_H_
+#define SHUFFLE_H_
+
+/*
+ * A bag. The items are stored in ram given by the user of the bag - an item
+ * can be in the bag several times to be drawn more often.
+ */
+typedef struct
+{
+  //the items (in ram)
+  uint8_t* items;
+  //how many items are in the bag
+  uint8_t size;
+  //how many are not drawn in this round
+  uint8_t remaining;
+  //the item drawn last
+  uint8_t last;
+} shuffle_bag;
+
+//start a bag with 'size' items
+void shuffle_init(shuffle_bag* bag, uint8_t items[], uint8_t size);
+//tell the bag which item was drawn last, so it is not drawn next
+void shuffle_set_last(shuffle_bag* bag, uint8_t item);
+//draw the next item
+uint8_t shuffle_next(shuffle_bag* bag);
+
+#endif /* SHUFFLE_H_ */
@@ -24,49 +24,92 @@
 #include <stdio.h>
 //we need some special register and tool definitions
 #include <avr/sfr_defs.h>
+//the idle time is measured with the display timer
+#include <avr/io.h>
+//the lookup table is stored in the flash
+#include <avr/pgmspace.h>
+//we need to change the tasks without being interrupted
+#include <util/atomic.h>
+//we are using interrupts to wake up from sleep
+#include <avr/interrupt.h>
+//we send the CPU to sleep if there is nothing to do
+#include <avr/sleep.h>
 
 #include "state.h"
 
+/*
+ * The handles of tasks are just their priority (0 to 15). The handles of
+ * states are marked with STATE_IS_STATE and contain the number of the state.
+ */
+#define STATE_IS_STATE 0x80
+
 /*
  * Here are the bits stored to indicate that a task or state is active.
- * To access the state variable faster we permanently bind it to a register
- * see http://www.nongnu.org/avr-libc/user-manual/FAQ.html#faq_regbind
+ * Tasks & states are stored separately, so that we can quickly find the
+ * active task with the highest priority. Bit 0 of the tasks is priority 0.
+ * Tasks are activated by interrupts too, so changing them outside of an
+ * interrupt must be done with disabled interrupts.
+ */
+volatile uint16_t state_tasks;
+uint16_t state_states;
+//how much states are registered - this defines the handle for the
+//next state that is registered
+uint8_t registered_states = 0;
+
+//an array to store all callbacks - the index is the priority
+state_callback state_callbacks[STATE_MAX_TASKS];
+
+/*
+ * To find the lowest set bit of 4 bits we just look it up in this table.
  */
-register uint8_t state asm("r4");
-//with each time state_process is called we just check one task if it needs
-//calculations to return faster, e.g. to do other things in the main routine
-//here is the number of the task stored that is checked.
-uint8_t status_step = 0;
-//how much states & tasks are registers - this defines the handle for the
-//next task or state that is registered
-uint8_t registered_tasks = 0;
+const prog_uint8_t state_lowest_bit[16] =
+  { 0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 };
 
-//an array to store all callbacks
-state_callback state_callbacks[8] =
-  { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+/*
+ * For measurements we count how often the CPU woke up from sleep and measure
+ * how much time the CPU sleeps:
+ * The display timer tells us how long each of its periods is, so we count
+ * the time in us. Going to sleep we note the time (the start of the current
+ * period plus Timer 0, which counts the us since then). When the display
+ * timer wakes the CPU up we add the time since then as idle time.
+ * After STATE_IDLE_WINDOW us the idle & the total time of the window are
+ * stored for state_get_idle_percent.
+ */
+#define STATE_IDLE_WINDOW 1000000UL
+volatile uint8_t state_sleeping;
+volatile uint16_t state_wakeups;
+//the time at the start of the current display period (in us)
+volatile uint32_t state_time;
+//how long the current display period is
+uint16_t state_period;
+//the time the CPU went to sleep
+volatile uint32_t state_sleep_start;
+//the idle & total time of the current and of the last window
+uint32_t state_idle_time;
+uint32_t state_window_time;
+volatile uint32_t state_idle_window;
+volatile uint32_t state_total_window;
 
 // register a task
 uint8_t
-state_register_task(state_callback callback)
+state_register_task(state_callback callback, uint8_t priority)
 {
   //we do our work only if all input parameters are correct
-  if ((registered_tasks < 8) && (callback != NULL))
+  //and nobody else has this priority
+  if ((priority < STATE_MAX_TASKS) && (callback != NULL)
+      && (state_callbacks[priority] == NULL))
     {
       //store the callback handle
-      state_callbacks[registered_tasks] = callback;
-      //the result is the bit pattern to check the state & task register
-      uint8_t result = _BV(registered_tasks);
+      state_callbacks[priority] = callback;
       //to be really sure the the corresponding bit to 0
-      state_deactivate(result);
-      //we have a task more - so the next one is this task number plus 1
-      registered_tasks++;
+      state_deactivate(priority);
       //and return the handle to the task
-      return result;
+      return priority;
     }
   //if there was something wrong return an improbable number to indicate the error
   else
     {
-      return 0xff;
+      return STATE_NONE;
     }
 }
 
@@ -75,21 +118,21 @@ uint8_t
 state_register_state(void)
 {
   //we do our work only if all input parameters are correct
-  if (registered_tasks < 8)
+  if (registered_states < STATE_MAX_STATES)
     {
-      //the result is the bit pattern to check the state & task register
-      uint8_t result = _BV(registered_tasks);
+      //the result is the number of the state, marked as state
+      uint8_t result = STATE_IS_STATE | registered_states;
       //to be really sure the the corresponding bit to 0
       state_deactivate(result);
-      //we have a state more - so the next one is this task number plus 1
-      registered_tasks++;
-      //and return the handle to the task
+      //we have a state more - so the next one is this state number plus 1
+      registered_states++;
+      //and return the handle to the state
       return result;
     }
   //if there was something wrong return an improbable number to indicate the error
   else
     {
-      return 0xff;
+      return STATE_NONE;
     }
 }
 
@@ -97,36 +140,158 @@ state_register_state(void)
 void
 state_activate(uint8_t state_number)
 {
-  state |= state_number;
+  if (state_number & STATE_IS_STATE)
+    {
+      state_states |= _BV(state_number & 0xf);
+    }
+  else
+    {
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+          state_tasks |= (uint16_t) _BV(state_number & 0xf);
+        }
+    }
 }
 
 //deactivate the state bit for the given state or task
 void
 state_deactivate(uint8_t state_number)
 {
-  state &= ~(state_number);
+  if (state_number & STATE_IS_STATE)
+    {
+      state_states &= ~_BV(state_number & 0xf);
+    }
+  else
+    {
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+          state_tasks &= ~((uint16_t) _BV(state_number & 0xf));
+        }
+    }
 }
 
 //check if the state bit is set for the given state or task
 uint8_t
 state_is_active(uint8_t state_number)
 {
-  return state & state_number;
+  if (state_number & STATE_IS_STATE)
+    {
+      return (state_states & _BV(state_number & 0xf)) != 0;
+    }
+  else
+    {
+      return (state_tasks & _BV(state_number & 0xf)) != 0;
+    }
 }
 
-//look for a active task and call its callbak
+/*
+ * Look for the active task with the highest priority and call its callbak.
+ * Finding the task takes always the same time: We look at the lower byte or
+ * the upper byte, then at the lower or upper 4 bits of it and look the lowest
+ * bit of these 4 bits up in a table.
+ */
 void
 state_process(void)
 {
-  //advance one task and ensure that you zero after 7
-  status_step = (status_step + 1) & 7;
-  //if the corresponding task is active and we now a callback for this
-  //(i.e. it is no state) we call the callback
-  if ((state & _BV(status_step)) && (state_callbacks[status_step] != NULL))
+  uint16_t tasks;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      tasks = state_tasks;
+    }
+  //nothing to do
+  if (!tasks)
+    {
+      return;
+    }
+  uint8_t priority = 0;
+  uint8_t bits = tasks;
+  if (!bits)
+    {
+      bits = tasks >> 8;
+      priority = 8;
+    }
+  if (!(bits & 0xf))
+    {
+      bits >>= 4;
+      priority += 4;
+    }
+  priority += pgm_read_byte(&state_lowest_bit[bits & 0xf]);
+  //we deactivate the task
+  state_deactivate(priority);
+  //and call the callback of the task
+  state_callbacks[priority]();
+}
+
+/*
+ * Send the CPU to sleep if there is no active task.
+ * The CPU is woken up by the next interrupt (at latest by the display timer).
+ * Since an interrupt could activate a task right between checking the tasks
+ * and sleeping, we check with disabled interrupts. The instruction after sei
+ * is always executed before any interrupt - so we cannot miss the wake up.
+ */
+void
+state_sleep(void)
+{
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  cli();
+  if (!state_tasks)
+    {
+      state_sleep_start = state_time + TCNT0;
+      state_sleeping = 1;
+      sleep_enable();
+      sei();
+      sleep_cpu();
+      sleep_disable();
+      state_sleeping = 0;
+      state_wakeups++;
+    }
+  sei();
+}
+
+/*
+ * Count an interrupt of the display timer for the idle measurement. The
+ * previous period is over, the next one lasts 'us'.
+ * This is called from the interrupt routine - so keep it short.
+ */
+void
+state_count_tick(uint16_t us)
+{
+  state_time += state_period;
+  state_window_time += state_period;
+  state_period = us;
+  if (state_sleeping)
+    {
+      //the CPU slept from state_sleep_start until now
+      if (state_time > state_sleep_start)
+        {
+          state_idle_time += state_time - state_sleep_start;
+        }
+      //if it is still sleeping at the next interrupt it slept all the time
+      state_sleep_start = state_time;
+    }
+  if (state_window_time >= STATE_IDLE_WINDOW)
+    {
+      state_idle_window = state_idle_time;
+      state_total_window = state_window_time;
+      state_idle_time = 0;
+      state_window_time = 0;
+    }
+}
+
+//how much time did the CPU sleep in the last measurement window?
+uint8_t
+state_get_idle_percent(void)
+{
+  uint32_t idle;
+  uint32_t total;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      idle = state_idle_window;
+      total = state_total_window;
+    }
+  if (total == 0)
     {
-      //we deactivate the task
-      state_deactivate(_BV(status_step));
-      //and call the callback of the task
-      state_callbacks[status_step]();
+      return 0;
     }
+  return idle * 100 / total;
 }
@@ -37,8 +37,8 @@
  *          This is e.g. useful if you have a timer which requires a calculation
  *          until the next timeout happens. The function of the taks is called
  *          'callback'.
- * You can only have 8 states & tasks in sum. The status of each state & task
- * is stored in a register variable which has only 8 bits.
+ * You can have 16 states & 16 tasks. Each task has its own priority: if several
+ * tasks are active the task with the lowest priority number is called first.
  */
 
 //this is the definition of a callback
@@ -46,13 +46,36 @@
 //void callbak(void);
 typedef void(*state_callback)(void);
 
+//how many states & tasks can be registered
+#define STATE_MAX_STATES 16
+#define STATE_MAX_TASKS 16
+
+/*
+ * The priorities of the tasks. Each task needs its own priority - and the
+ * priority must be less than STATE_MAX_TASKS. Lower numbers are more
+ * important.
+ */
+//rendering at the vsync must be quick to display it in the next scan
+#define STATE_PRIORITY_VSYNC 0
+//the software timers
+#define STATE_PRIORITY_TIMER 1
+//rendering text must not wait for loading sequences
+#define STATE_PRIORITY_TEXT 2
+//loading the next sequence
+#define STATE_PRIORITY_SEQUENCE 3
+//executing the animation programs
+#define STATE_PRIORITY_PROGRAM 4
+
 /*
  * The state & task register routines return an identifier for the state or task
  * keep this value in a variable since it is used to identify the state or task.
+ * STATE_NONE is returned if something was wrong - you can also use it to
+ * indicate 'no task'.
  */
+#define STATE_NONE 0xff
 
-// register a task with it's callback
-uint8_t state_register_task(state_callback callback);
+// register a task with it's callback & priority
+uint8_t state_register_task(state_callback callback, uint8_t priority);
 // register a state
 uint8_t state_register_state(void);
 
@@ -67,4 +90,14 @@ void state_activate(uint8_t state_number);
 //or deactivate a certain state & task
 void state_deactivate(uint8_t state_number);
 
+//send the CPU to sleep until the next interrupt if there is no active task
+void state_sleep(void);
+//count an interrupt of the display timer to measure the idle time
+//us is the length of the period which starts now
+void state_count_tick(uint16_t us);
+//how many percent of the time did the CPU sleep recently
+uint8_t state_get_idle_percent(void);
+//how often did the CPU wake up from sleep (for measurements)
+extern volatile uint16_t state_wakeups;
+
 #endif /* STATE_H_ */
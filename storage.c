@@ -0,0 +1,195 @@
+/*
+ * storage.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ * This file saves the state of the random generator and the recently shown
+ * sequences to the EEPROM & loads them at startup.
+ * The EEPROM can only be written about 100000 times. So each save goes to the
+ * next slot of a ring of STORAGE_SLOTS slots, and we save at most
+ * STORAGE_WRITES_PER_HOUR times an hour. With 32 slots and 4 saves an hour
+ * each slot is written every 8 hours - that lasts about 90 years.
+ * Each slot has a counter, increased with each save. The newest slot is the
+ * one whose next slot does not continue the count. A checksum tells if a slot
+ * is valid - an erased EEPROM or a save interrupted by switching off are
+ * simply ignored.
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+//we need the standard integer types
+#include <stdint.h>
+//and memory routines
+#include <string.h>
+#include <stddef.h>
+//the state is saved in the EEPROM
+#include <avr/eeprom.h>
+
+//the write budget is refilled by a timer
+#include "state.h"
+#include "timer.h"
+//we save the random generator
+#include "random.h"
+//and we need our own definitions
+#include "storage.h"
+
+//how many slots the ring has
+#define STORAGE_SLOTS 32
+//marks that there is no valid slot
+#define STORAGE_NONE 0xff
+//the write budget is refilled each minute
+#define STORAGE_MINUTE 60000
+#define STORAGE_REFILL_MINUTES (60 / STORAGE_WRITES_PER_HOUR)
+//an empty EEPROM (all 0xff) must not have a valid checksum
+#define STORAGE_CHECK_SEED 0xa5
+
+/*
+ * A slot of the ring
+ */
+typedef struct
+{
+  uint8_t counter;
+  uint16_t random_state[2];
+  uint8_t history[STORAGE_HISTORY];
+  uint8_t check;
+} storage_slot;
+
+storage_slot storage_slots[STORAGE_SLOTS] EEMEM;
+
+//the newest slot and its counter
+uint8_t storage_newest = STORAGE_NONE;
+uint8_t storage_counter;
+//how many writes we may do right now and the minutes until the next one
+uint8_t storage_budget = 1;
+uint8_t storage_minutes;
+
+/*
+ * Here we prototype some private functions we only need in this module.
+ */
+//read a slot, returns 0 if it is not valid
+uint8_t
+storage_read_slot(uint8_t number, storage_slot* slot);
+//calculate the checksum of a slot
+uint8_t
+storage_checksum(const storage_slot* slot);
+//the minute timer refilling the write budget
+void
+storage_count_minute(void);
+
+/*
+ * Find the newest slot and load it.
+ * Reading all slots takes 32 * 10 byte reads - not even 0.5 ms.
+ */
+uint8_t
+storage_init(uint8_t history[])
+{
+  storage_slot slot;
+  uint8_t number;
+  timer_register(storage_count_minute, STORAGE_MINUTE);
+  for (number = 0; number < STORAGE_SLOTS; number++)
+    {
+      if (storage_read_slot(number, &slot))
+        {
+          //the newest slot is not continued by the next one
+          uint8_t counter = slot.counter;
+          uint8_t next = (number + 1) % STORAGE_SLOTS;
+          if (!storage_read_slot(next, &slot)
+              || (slot.counter != (uint8_t) (counter + 1)))
+            {
+              storage_newest = number;
+              storage_counter = counter;
+              break;
+            }
+        }
+    }
+  if (storage_newest == STORAGE_NONE)
+    {
+      return 0;
+    }
+  storage_read_slot(storage_newest, &slot);
+  random_set_state(slot.random_state);
+  memcpy(history, slot.history, STORAGE_HISTORY);
+  return 1;
+}
+
+/*
+ * Save the state to the next slot.
+ * This waits until the EEPROM is written - about 3.4 ms for each changed
+ * byte, so up to 35 ms. The display is not disturbed (it is refreshed by the
+ * interrupt), only the next sprite may come a bit late. So save only at the
+ * start of a new sequence.
+ */
+void
+storage_save(const uint8_t history[])
+{
+  if (storage_budget == 0)
+    {
+      return;
+    }
+  storage_budget--;
+  storage_slot slot;
+  storage_newest = (storage_newest + 1) % STORAGE_SLOTS;
+  storage_counter++;
+  slot.counter = storage_counter;
+  random_get_state(slot.random_state);
+  memcpy(slot.history, history, STORAGE_HISTORY);
+  slot.check = storage_checksum(&slot);
+  eeprom_update_block(&slot, &storage_slots[storage_newest], sizeof(slot));
+}
+
+/*
+ * Read a slot from the EEPROM and check it.
+ */
+uint8_t
+storage_read_slot(uint8_t number, storage_slot* slot)
+{
+  eeprom_read_block(slot, &storage_slots[number], sizeof(storage_slot));
+  return slot->check == storage_checksum(slot);
+}
+
+/*
+ * The checksum is simply the sum of all bytes of the slot (without the
+ * checksum).
+ */
+uint8_t
+storage_checksum(const storage_slot* slot)
+{
+  const uint8_t* bytes = (const uint8_t*) slot;
+  uint8_t sum = STORAGE_CHECK_SEED;
+  uint8_t i;
+  for (i = 0; i < offsetof(storage_slot, check); i++)
+    {
+      sum += bytes[i];
+    }
+  return sum;
+}
+
+/*
+ * The minute timer - each STORAGE_REFILL_MINUTES we may write once more, but
+ * we never save up more than the writes of an hour.
+ */
+void
+storage_count_minute(void)
+{
+  storage_minutes++;
+  if (storage_minutes >= STORAGE_REFILL_MINUTES)
+    {
+      storage_minutes = 0;
+      if (storage_budget < STORAGE_WRITES_PER_HOUR)
+        {
+          storage_budget++;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * storage.h
+ *
+ * This file contains the routines to remember the random generator and the
+ * recently shown sequences in the EEPROM - so the Blinken Button continues
+ * with new animations after it was switched off.
+ *
+ *  http://interactive-matter.eu/
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef STORAGE_H_
+#define STORAGE_H_
+
+//how many recently shown sequences are remembered
+#define STORAGE_HISTORY 4
+//how often we may write to the EEPROM
+#define STORAGE_WRITES_PER_HOUR 4
+
+//load the last saved state (this registers a timer), returns 0 if there is none
+uint8_t storage_init(uint8_t history[]);
+//save the current state - if the write budget allows it
+void storage_save(const uint8_t history[]);
+
+#endif /* STORAGE_H_ */
@@ -0,0 +1,227 @@
+/*
+ * timer.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  The timers are a so called timer wheel. The wheel has TIMER_WHEEL_SLOTS
+ *  slots, one for each millisecond. Each millisecond the wheel turns one
+ *  slot further and we check only the timers in this slot. A timer is
+ *  put into the slot of the millisecond it is due. If it is due later than one
+ *  turn of the wheel it has to wait some additional rounds.
+ *  The milliseconds are counted by the display timer: it tells us how long
+ *  each of its periods is. So we do not need Timer 1 or Timer 2 at all and can
+ *  switch them off.
+ */
+//include the definitions for our chip, like pins, ports & so on
+#include <avr/io.h>
+//we need to disable interrupts for a short time
+#include <avr/interrupt.h>
+//we power up & down chip components as needed, here are the functions to do this
+#include <avr/power.h>
+#include <stdio.h>
+
+//the timers are processed by a task
+#include "state.h"
+//and we need our own definitions
+#include "timer.h"
+
+//how many slots has the wheel (must be a power of 2)
+#define TIMER_WHEEL_SLOTS 16
+#define TIMER_WHEEL_SHIFT 4
+//marks the end of the list of timers in a slot
+#define TIMER_NONE 0xff
+
+/*
+ * The timers: callback & period in ms of each timer, how many rounds of the
+ * wheel the timer has to wait and which timer comes next in the same slot.
+ */
+state_callback timer_callbacks[TIMER_MAX];
+uint16_t timer_period[TIMER_MAX];
+uint16_t timer_rounds[TIMER_MAX];
+uint8_t timer_next[TIMER_MAX];
+//which timers are in the wheel (bit 0 is timer 0)
+uint8_t timer_waiting;
+//how many timers are registered
+uint8_t timer_count;
+
+//the first timer of each slot of the wheel
+uint8_t timer_wheel[TIMER_WHEEL_SLOTS];
+//the slot of the current millisecond
+uint8_t timer_now;
+
+//the task processing the wheel
+uint8_t timer_task;
+
+/*
+ * The display timer adds the length of each of its periods in us. Each
+ * complete millisecond is counted in timer_elapsed until the timer task
+ * turns the wheel.
+ */
+uint16_t timer_us;
+volatile uint8_t timer_elapsed;
+
+/*
+ * Here we prototype some private functions we only need in this module.
+ */
+//the task turning the wheel
+void
+timer_process(void);
+//put a timer in the wheel
+void
+timer_schedule(uint8_t timer, uint16_t delay);
+
+void
+timer_init(void)
+{
+  uint8_t slot;
+  for (slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+    {
+      timer_wheel[slot] = TIMER_NONE;
+    }
+  timer_task = state_register_task(timer_process, STATE_PRIORITY_TIMER);
+  //all timing is done by the display timer
+  power_timer1_disable();
+  power_timer2_disable();
+}
+
+//register a new timer
+uint8_t
+timer_register(state_callback callback, uint16_t period)
+{
+  //we do our work only if all input parameters are correct
+  if ((timer_count < TIMER_MAX) && (callback != NULL))
+    {
+      uint8_t timer = timer_count;
+      timer_callbacks[timer] = callback;
+      timer_period[timer] = period;
+      if (period != TIMER_STOPPED)
+        {
+          timer_schedule(timer, period);
+        }
+      timer_count++;
+      return timer;
+    }
+  //if there was something wrong return an improbable number to indicate the error
+  else
+    {
+      return 0xff;
+    }
+}
+
+//change the period of a timer
+void
+timer_set_period(uint8_t timer, uint16_t period)
+{
+  if (timer < timer_count)
+    {
+      timer_period[timer] = period;
+      //a stopped timer is not in the wheel - start it again
+      if ((period != TIMER_STOPPED) && !(timer_waiting & _BV(timer)))
+        {
+          timer_schedule(timer, period);
+        }
+    }
+}
+
+/*
+ * Put a timer into the slot of the wheel where it is due after 'delay' ms.
+ * The slot is visited the first time after (delay-1) % TIMER_WHEEL_SLOTS + 1
+ * ms and then once each turn of the wheel.
+ */
+void
+timer_schedule(uint8_t timer, uint16_t delay)
+{
+  if (delay == 0)
+    {
+      delay = 1;
+    }
+  uint8_t slot = (timer_now + delay) & (TIMER_WHEEL_SLOTS - 1);
+  timer_rounds[timer] = (delay - 1) >> TIMER_WHEEL_SHIFT;
+  timer_next[timer] = timer_wheel[slot];
+  timer_wheel[slot] = timer;
+  timer_waiting |= _BV(timer);
+}
+
+/*
+ * The timer task.
+ * Turns the wheel one slot for each elapsed millisecond and calls all timers
+ * which are due.
+ */
+void
+timer_process(void)
+{
+  uint8_t elapsed;
+  //get the elapsed milliseconds - the interrupt may change them meanwhile
+  cli();
+  elapsed = timer_elapsed;
+  timer_elapsed = 0;
+  sei();
+
+  while (elapsed)
+    {
+      elapsed--;
+      timer_now = (timer_now + 1) & (TIMER_WHEEL_SLOTS - 1);
+      //take all timers out of the slot and put them back where they belong
+      uint8_t timer = timer_wheel[timer_now];
+      timer_wheel[timer_now] = TIMER_NONE;
+      while (timer != TIMER_NONE)
+        {
+          uint8_t next = timer_next[timer];
+          if (timer_rounds[timer])
+            {
+              //wait another round
+              timer_rounds[timer]--;
+              timer_next[timer] = timer_wheel[timer_now];
+              timer_wheel[timer_now] = timer;
+            }
+          else
+            {
+              //the timer is due - call it and schedule it again
+              //(the callback may have changed the period). A stopped timer
+              //just leaves the wheel.
+              timer_waiting &= ~_BV(timer);
+              if (timer_period[timer] != TIMER_STOPPED)
+                {
+                  timer_callbacks[timer]();
+                }
+              if ((timer_period[timer] != TIMER_STOPPED)
+                  && !(timer_waiting & _BV(timer)))
+                {
+                  timer_schedule(timer, timer_period[timer]);
+                }
+            }
+          timer = next;
+        }
+    }
+}
+
+/*
+ * Count the time of the display timer.
+ * This is called from the interrupt routine - so keep it short.
+ */
+void
+timer_count_us(uint16_t us)
+{
+  timer_us += us;
+  if (timer_us >= 1000)
+    {
+      timer_us -= 1000;
+      timer_elapsed++;
+      state_activate(timer_task);
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * timer.h
+ *
+ * This file contains software timers, which call a routine periodically.
+ * All timers are driven by the display timer (Timer 0), so no other hardware
+ * timer is needed.
+ *
+ *  http://interactive-matter.eu/
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+//how many timers can be registered
+#define TIMER_MAX 4
+
+/*
+ * The timers call their callback (see state.h) every 'period' milliseconds.
+ * The callbacks are called from a task - not from an interrupt routine. So
+ * they can take their time - but they are called a bit late if other tasks
+ * take their time too.
+ * The register routine returns an identifier for the timer, keep it to change
+ * the timer later.
+ * A timer with the period TIMER_STOPPED is not called at all - until it gets
+ * a period again.
+ */
+#define TIMER_STOPPED 0
+
+//initialize the timers (this registers a task)
+void timer_init(void);
+//register a timer which calls callback every 'period' ms
+uint8_t timer_register(state_callback callback, uint16_t period);
+//change the period of the timer - starting with the next call, a stopped
+//timer is started (and called after 'period' ms)
+void timer_set_period(uint8_t timer, uint16_t period);
+//count the time in us - this is called by the display timer interrupt
+void timer_count_us(uint16_t us);
+
+#endif /* TIMER_H_ */
@@ -0,0 +1,173 @@
+/*
+ * duty-model.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ * This is a small program for the development computer (not for the Blinken
+ * Button). It calculates how long each row of the sprites is lit with the
+ * current dot correction (see dot_correction in core-flash-content.c) and
+ * how bright each LED appears. By that you can tune the dot correction table
+ * without flashing the Blinken Button again and again.
+ *
+ * The brightness of an LED is modelled as its duty (which part of the frame
+ * its row is lit) times its current. The current of each LED drops with the
+ * number of LEDs lit in the row, since the battery and the ATmega can only
+ * deliver so much:
+ *   current = 1 / (1 + droop * (number of LEDs - 1))
+ * The droop can be given as argument (default 0.12). Measure it by comparing
+ * a row with one LED to a row with 8 LEDs.
+ * The row interrupt is modelled too (see DISPLAY_ISR_TICKS): each plane takes
+ * one interrupt, so it shows how busy the CPU is.
+ *
+ * Usage: tools/duty-model [droop]
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "../display.h"
+//we include the flash content directly, since we need to know how many
+//sprites are defined
+#include "../core-flash-content.c"
+#include "../custom-flash-content.c"
+
+//a row with unit u is displayed u, 2u, 4u ... ticks
+#define PLANE_TICKS(unit) (DISPLAY_PLANE_UNITS * (unit))
+
+double droop = 0.12;
+
+//the result of modelling a scan
+uint16_t scan_ticks;
+uint16_t scan_interrupts;
+uint16_t scan_busy_ticks;
+
+/*
+ * The current of an LED in a row with num_bit lit LEDs
+ */
+double
+led_current(uint8_t num_bit)
+{
+  return 1.0 / (1.0 + droop * (num_bit - 1));
+}
+
+/*
+ * Model a scan the way display_render_row displays it: plane by plane each
+ * lit row, each plane started by an interrupt.
+ */
+void
+model_scan(const uint8_t units[], uint8_t count)
+{
+  uint8_t plane;
+  uint8_t row;
+  scan_ticks = 0;
+  scan_interrupts = 0;
+  scan_busy_ticks = 0;
+  for (plane = 0; plane < DISPLAY_BIT_PLANES; plane++)
+    {
+      for (row = 0; row < count; row++)
+        {
+          scan_ticks += units[row] << plane;
+          scan_interrupts++;
+          scan_busy_ticks += DISPLAY_ISR_TICKS;
+        }
+    }
+}
+
+/*
+ * Model a frame as the display does: only lit rows are displayed, each with
+ * its own unit. Prints the duty and brightness of each row.
+ */
+void
+model_frame(const uint8_t rows[8])
+{
+  display_line lines[8];
+  uint8_t units[8];
+  uint8_t count = 0;
+  uint8_t row;
+  uint16_t frame_ticks;
+
+  display_convert_sprite(lines, (uint8_t*) rows);
+  for (row = 0; row < 8; row++)
+    {
+      if (lines[row].num_bit)
+        {
+          count++;
+        }
+    }
+  if (count == 0)
+    {
+      printf("    empty frame\n");
+      return;
+    }
+  //the units of the lit rows, in the order they are displayed
+  uint8_t lit = 0;
+  for (row = 0; row < 8; row++)
+    {
+      if (lines[row].num_bit)
+        {
+          units[lit++] = display_get_row_unit(count, lines[row].num_bit);
+        }
+    }
+  model_scan(units, count);
+  frame_ticks = scan_ticks;
+  for (row = 0; row < 8; row++)
+    {
+      uint8_t num_bit = lines[row].num_bit;
+      if (num_bit == 0)
+        {
+          printf("    row %i: dark\n", row);
+          continue;
+        }
+      uint8_t unit = display_get_row_unit(count, num_bit);
+      double duty = (double) PLANE_TICKS(unit) / frame_ticks;
+      printf("    row %i: %i LEDs unit %2i us on %3i us duty %5.1f%%"
+        " brightness %5.3f\n", row, num_bit, unit, PLANE_TICKS(unit),
+          100.0 * duty, duty * led_current(num_bit));
+    }
+  printf("    frame %i us = %i FPS, %i interrupts, %i%% CPU in the "
+    "interrupt\n", frame_ticks, 1000000 / frame_ticks, scan_interrupts,
+      scan_busy_ticks * 100 / frame_ticks);
+}
+
+int
+main(int argc, char* argv[])
+{
+  uint8_t num_bit;
+  int sprite;
+
+  if (argc > 1)
+    {
+      droop = atof(argv[1]);
+    }
+  //first the plain table: all 8 rows lit with the same number of LEDs
+  printf("dot correction (droop %.3f), all 8 rows lit:\n", droop);
+  for (num_bit = 1; num_bit <= 8; num_bit++)
+    {
+      uint8_t unit = display_get_row_unit(8, num_bit);
+      printf("  %i LEDs: on-time %2i/16 unit %2i us relative brightness "
+        "%5.3f\n", num_bit, dot_correction[num_bit], unit,
+          (double) unit / DISPLAY_BCM_UNIT * led_current(num_bit));
+    }
+  //and now each sprite
+  for (sprite = 0; sprite < sizeof(predefined_sprites) / 8; sprite++)
+    {
+      printf("sprite %i:\n", sprite);
+      model_frame(predefined_sprites[sprite]);
+    }
+  return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * pgmspace.h
+ *
+ * Just enough of avr/pgmspace.h to compile the flash content on the
+ * development computer. On the computer there is no separate flash memory,
+ * so all flash routines are plain memory accesses.
+ * This is used by the tools in this directory only - never for the Blinken
+ * Button itself.
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HOST_PGMSPACE_H_
+#define HOST_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+
+typedef char prog_char;
+typedef uint8_t prog_uint8_t;
+typedef int8_t prog_int8_t;
+typedef uint16_t prog_uint16_t;
+typedef const char* PGM_P;
+typedef const void* PGM_VOID_P;
+
+#define PSTR(s) (s)
+#define pgm_read_byte(address) (*(const uint8_t*) (address))
+#define pgm_read_word(address) (*(address))
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+#define strlen_P strlen
+
+#endif /* HOST_PGMSPACE_H_ */
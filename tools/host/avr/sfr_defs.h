@@ -0,0 +1,30 @@
+/*
+ * sfr_defs.h
+ *
+ * Just enough of avr/sfr_defs.h to compile the flash content and the display
+ * conversion on the development computer.
+ * This is used by the tools in this directory only - never for the Blinken
+ * Button itself.
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HOST_SFR_DEFS_H_
+#define HOST_SFR_DEFS_H_
+
+#define _BV(bit) (1 << (bit))
+
+#endif /* HOST_SFR_DEFS_H_ */
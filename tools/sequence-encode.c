@@ -0,0 +1,340 @@
+/*
+ * sequence-encode.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ * This is a small program for the development computer (not for the Blinken
+ * Button). It compresses the animations of all sequences in
+ * custom-flash-content.c to frame streams (see sequence-frames.h) and prints
+ * them as C source. If a sprite is just the previous sprite transformed (see
+ * transform.h) only the transformation is stored. The Makefile uses it to
+ * generate sequence-frames.c.
+ * It also calculates the alias table to select the sequences by their weight.
+ * How well the animations are compressed is printed to stderr.
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <avr/sfr_defs.h>
+#include <avr/pgmspace.h>
+
+#include "../sequence-frames.h"
+#include "../transform.h"
+//we include the flash content directly, since we need to know how many
+//sprites are defined
+#include "../custom-flash-content.c"
+
+//how many bytes are printed in the current line
+int line_bytes;
+
+/*
+ * Print one byte of a frame stream
+ */
+void
+print_byte(uint8_t value)
+{
+  if (line_bytes == 8)
+    {
+      printf("\n   ");
+      line_bytes = 0;
+    }
+  printf(" 0x%02x,", value);
+  line_bytes++;
+}
+
+/*
+ * Print a repetition of the current frame, split into pieces of at most
+ * FRAME_MAX_REPEAT. Returns the number of bytes used.
+ */
+int
+print_repeat(int count)
+{
+  int size = 0;
+  while (count > 0)
+    {
+      int repeat = (count > FRAME_MAX_REPEAT) ? FRAME_MAX_REPEAT : count;
+      print_byte(repeat);
+      count -= repeat;
+      size++;
+    }
+  return size;
+}
+
+/*
+ * Print the frame stream of an animation (the number of sprites followed by
+ * their indices in predefined_sprites, maybe with a transformation). Returns
+ * the size of the stream.
+ */
+int
+print_stream(int number, const uint16_t sprites[])
+{
+  uint8_t length = sprites[0];
+  uint8_t previous[8];
+  uint8_t have_previous = 0;
+  int repeat = 0;
+  int size = 0;
+  uint8_t position;
+  printf("const prog_uint8_t sequence_frames_%i[] =\n  {", number);
+  line_bytes = 8;
+  for (position = 0; position < length; position++)
+    {
+      uint16_t sprite = sprites[position + 1];
+      uint8_t frame[8];
+      uint8_t mask = 0;
+      uint8_t changed = 0;
+      uint8_t transform = TRANSFORM_NONE;
+      uint8_t row;
+      memcpy(frame, predefined_sprites[SPRITE_INDEX(sprite)], 8);
+      transform_image(SPRITE_TRANSFORMATION(sprite), frame);
+      if (have_previous)
+        {
+          for (row = 0; row < 8; row++)
+            {
+              if (frame[row] != previous[row])
+                {
+                  mask |= _BV(row);
+                  changed++;
+                }
+            }
+          //the same frame again - just count it
+          if (mask == 0)
+            {
+              repeat++;
+              continue;
+            }
+          //maybe it is just the previous frame transformed
+          for (transform = TRANSFORM_NONE + 1; transform < TRANSFORM_COUNT;
+              transform++)
+            {
+              uint8_t transformed[8];
+              memcpy(transformed, previous, 8);
+              transform_image(transform, transformed);
+              if (memcmp(transformed, frame, 8) == 0)
+                {
+                  break;
+                }
+            }
+        }
+      //the last frame was shown once, the remaining time are repetitions
+      size += print_repeat(repeat);
+      repeat = 0;
+      if (have_previous && (transform < TRANSFORM_COUNT))
+        {
+          print_byte(FRAME_TRANSFORM | transform);
+          size++;
+        }
+      //a delta is only worth it if it is smaller than the whole frame
+      else if (have_previous && (changed < 7))
+        {
+          print_byte(FRAME_DELTA);
+          print_byte(mask);
+          for (row = 0; row < 8; row++)
+            {
+              if (mask & _BV(row))
+                {
+                  print_byte(frame[row] ^ previous[row]);
+                }
+            }
+          size += 2 + changed;
+        }
+      else
+        {
+          print_byte(FRAME_KEY);
+          for (row = 0; row < 8; row++)
+            {
+              print_byte(frame[row]);
+            }
+          size += 9;
+        }
+      memcpy(previous, frame, 8);
+      have_previous = 1;
+    }
+  size += print_repeat(repeat);
+  print_byte(FRAME_END);
+  size++;
+  printf("\n  };\n\n");
+  return size;
+}
+
+/*
+ * Print the alias table for the weights of the sequences (Walker's alias
+ * method, as described by Vose).
+ * Each sequence has a column of the same size: the total weight. A column is
+ * filled with the weight of its sequence (times the number of sequences) -
+ * the rest of a column is filled by a sequence with too much weight, its
+ * alias. Returns the largest difference between the chance of a sequence and
+ * its weight (in 1/10000, rounded up - so any difference shows).
+ */
+int
+print_alias(void)
+{
+  long column[max_sequence];
+  uint8_t threshold[max_sequence];
+  uint8_t alias[max_sequence];
+  int small[max_sequence];
+  int large[max_sequence];
+  int small_count = 0;
+  int large_count = 0;
+  long total = 0;
+  int sequence;
+  int error = 0;
+  for (sequence = 0; sequence < max_sequence; sequence++)
+    {
+      total += sequences[sequence].weight;
+    }
+  for (sequence = 0; sequence < max_sequence; sequence++)
+    {
+      column[sequence] = (long) sequences[sequence].weight * max_sequence;
+      //by default a sequence fills its column (the threshold is at most 255)
+      threshold[sequence] = 255;
+      alias[sequence] = sequence;
+      if (column[sequence] < total)
+        {
+          small[small_count++] = sequence;
+        }
+      else
+        {
+          large[large_count++] = sequence;
+        }
+    }
+  while ((small_count > 0) && (large_count > 0))
+    {
+      int less = small[--small_count];
+      int more = large[--large_count];
+      //a column just below the total weight rounds to 256 - which does not
+      //fit into the byte, the alias gets the last 1/256 of the column
+      long exact = (column[less] * 256 + total / 2) / total;
+      threshold[less] = (exact > 255) ? 255 : exact;
+      alias[less] = more;
+      column[more] -= total - column[less];
+      if (column[more] < total)
+        {
+          small[small_count++] = more;
+        }
+      else
+        {
+          large[large_count++] = more;
+        }
+    }
+  printf("const _alias_struct sequence_alias[] PROGMEM =\n  {");
+  for (sequence = 0; sequence < max_sequence; sequence++)
+    {
+      printf("%s { %i, %i }%s", (sequence % 4) ? "" : "\n   ",
+          threshold[sequence], alias[sequence],
+          (sequence < max_sequence - 1) ? "," : "");
+    }
+  printf(" };\n");
+  //check how well the table matches the weights: the chance of the table
+  //(what the firmware draws) is compared with the exact chance of the weight
+  for (sequence = 0; sequence < max_sequence; sequence++)
+    {
+      long chance = 0;
+      int other;
+      for (other = 0; other < max_sequence; other++)
+        {
+          if (other == sequence)
+            {
+              chance += threshold[other];
+            }
+          if (alias[other] == sequence)
+            {
+              chance += 256 - threshold[other];
+            }
+        }
+      long long difference = chance * total
+          - (long long) sequences[sequence].weight * 256 * max_sequence;
+      if (difference < 0)
+        {
+          difference = -difference;
+        }
+      long long scale = (long long) 256 * max_sequence * total;
+      difference = (difference * 10000 + scale - 1) / scale;
+      if (difference > error)
+        {
+          error = difference;
+        }
+    }
+  return error;
+}
+
+int
+main(void)
+{
+  int sequence;
+  //for the animations used by several sequences we print the stream only once
+  int stream[max_sequence];
+  //the flash needed by the raw sprites, all sprites of all animations & streams
+  int sprites_size = sizeof(predefined_sprites);
+  int raw_size = 0;
+  int compressed_size = 0;
+  printf("/*\n * sequence-frames.c\n *\n"
+    " * Generated by tools/sequence-encode - do not edit, edit the sprites &\n"
+    " * sequences in custom-flash-content.c instead.\n */\n");
+  printf("#include <avr/pgmspace.h>\n\n");
+  printf("#include \"sequence-frames.h\"\n\n");
+  for (sequence = 0; sequence < max_sequence; sequence++)
+    {
+      const uint16_t* sprites = sequences[sequence].sprites;
+      int other;
+      //effects have no animation
+      if (sprites == NULL)
+        {
+          stream[sequence] = -1;
+          continue;
+        }
+      stream[sequence] = sequence;
+      for (other = 0; other < sequence; other++)
+        {
+          if (sequences[other].sprites == sprites)
+            {
+              stream[sequence] = other;
+              break;
+            }
+        }
+      if (stream[sequence] == sequence)
+        {
+          sprites_size += 2 * (1 + sprites[0]);
+          raw_size += 8 * sprites[0];
+          compressed_size += print_stream(sequence, sprites);
+        }
+    }
+  printf("const prog_uint8_t* const sequence_frames[] PROGMEM =\n  {");
+  for (sequence = 0; sequence < max_sequence; sequence++)
+    {
+      if (stream[sequence] < 0)
+        {
+          printf(" 0");
+        }
+      else
+        {
+          printf(" sequence_frames_%i", stream[sequence]);
+        }
+      printf("%s", (sequence < max_sequence - 1) ? "," : "");
+    }
+  printf(" };\n\n");
+  int alias_error = print_alias();
+  fprintf(stderr, "sequence-encode: %i sequences\n", max_sequence);
+  fprintf(stderr, "  sprites & animations:   %5i bytes\n", sprites_size);
+  fprintf(stderr, "  raw frames:             %5i bytes\n", raw_size);
+  fprintf(stderr, "  frame streams:          %5i bytes (%i%% of the sprites, "
+    "%i%% of the raw frames)\n", compressed_size, compressed_size * 100
+      / sprites_size, compressed_size * 100 / raw_size);
+  fprintf(stderr, "  alias table:            %5i bytes (chances within "
+    "%i/10000 of the weights)\n", (int) (max_sequence * sizeof(_alias_struct)),
+      alias_error);
+  return 0;
+}
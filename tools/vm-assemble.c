@@ -0,0 +1,454 @@
+/*
+ * vm-assemble.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ * This is a small program for the development computer (not for the Blinken
+ * Button). It translates the animation programs in custom-programs.vm to the
+ * instructions of the interpreter (see vm.h) and prints them as C source. The
+ * Makefile uses it to generate vm-programs.c.
+ *
+ * A program file has one instruction per line, everything after a ';' is a
+ * comment:
+ *  program <name>               - starts the next program (counted from 0,
+ *                                 use SEQUENCE_PROGRAM(number) in sequences[])
+ *  <label>:                     - marks a position for jump & chance
+ *  sprite <sprite>              - shows a sprite of predefined_sprites
+ *  transformed <sprite> <transformation>
+ *                               - shows a transformed sprite, e.g. invert
+ *                                 or rotate_90 (see transform.h)
+ *  blit <sprite> <x> <y> <mode> - draws a sprite over the image, mode is
+ *                                 replace, or, xor or and (see blit.h)
+ *  clear                        - shows an empty image
+ *  wait <frames>                - keeps the image for some more frames
+ *  speed <ms>                   - sets how long each frame is shown
+ *  loop <count> ... next        - repeats the instructions count times (at
+ *                                 most VM_LOOP_DEPTH loops inside each other)
+ *  jump <label>                 - continues at the label
+ *  chance <0-255> <label>       - jumps with a chance of chance/256
+ *  text <message>               - displays a message of messages[]
+ *  effect <effect> <frames>     - shows life, rain, fire or plasma
+ *  end                          - the program is finished
+ * A program is at most 256 bytes long.
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <avr/sfr_defs.h>
+#include <avr/pgmspace.h>
+
+#include "../vm.h"
+#include "../transform.h"
+#include "../blit.h"
+#include "../effects.h"
+//we include the flash content directly, since we need to know how many
+//sprites & messages are defined
+#include "../custom-flash-content.c"
+
+#define SPRITE_COUNT (int) (sizeof(predefined_sprites) / 8)
+
+#define MAX_PROGRAMS 32
+#define MAX_PROGRAM_SIZE 256
+#define MAX_LABELS 32
+#define MAX_NAME 32
+
+/*
+ * The names of the parameters
+ */
+typedef struct
+{
+  const char* name;
+  uint8_t value;
+} name_value;
+
+const name_value transformations[] =
+  {
+    { "none", TRANSFORM_NONE },
+    { "transpose", TRANSFORM_TRANSPOSE },
+    { "rotate_90", TRANSFORM_ROTATE_90 },
+    { "rotate_180", TRANSFORM_ROTATE_180 },
+    { "rotate_270", TRANSFORM_ROTATE_270 },
+    { "flip_horizontal", TRANSFORM_FLIP_HORIZONTAL },
+    { "flip_vertical", TRANSFORM_FLIP_VERTICAL },
+    { "invert", TRANSFORM_INVERT },
+    { "shift_left", TRANSFORM_SHIFT_LEFT },
+    { "shift_right", TRANSFORM_SHIFT_RIGHT },
+    { "shift_up", TRANSFORM_SHIFT_UP },
+    { "shift_down", TRANSFORM_SHIFT_DOWN },
+    { NULL, 0 } };
+
+const name_value modes[] =
+  {
+    { "replace", BLIT_REPLACE },
+    { "or", BLIT_OR },
+    { "xor", BLIT_XOR },
+    { "and", BLIT_AND },
+    { NULL, 0 } };
+
+const name_value effects[] =
+  {
+    { "life", EFFECT_LIFE },
+    { "rain", EFFECT_RAIN },
+    { "fire", EFFECT_FIRE },
+    { "plasma", EFFECT_PLASMA },
+    { NULL, 0 } };
+
+//the file we read & the current line (for error messages)
+const char* file_name;
+int line_number;
+
+//the program we are assembling
+char program_name[MAX_NAME];
+uint8_t program[MAX_PROGRAM_SIZE];
+int program_size;
+//the last instruction & how many loops are open
+int program_last;
+int loop_depth;
+int program_count;
+int total_size;
+
+//the labels of the program & the jumps to them (resolved at the end)
+char label_names[MAX_LABELS][MAX_NAME];
+int label_positions[MAX_LABELS];
+int label_count;
+char jump_names[MAX_LABELS][MAX_NAME];
+int jump_positions[MAX_LABELS];
+int jump_count;
+
+/*
+ * Stop with an error message
+ */
+void
+fail(const char* message, const char* detail)
+{
+  fprintf(stderr, "%s:%i: %s '%s'\n", file_name, line_number, message, detail);
+  exit(1);
+}
+
+/*
+ * Get the next word of the line - fails if there is none
+ */
+char*
+next_word(void)
+{
+  char* word = strtok(NULL, " \t\r\n");
+  if (word == NULL)
+    {
+      fail("missing parameter", "");
+    }
+  return word;
+}
+
+/*
+ * Get a number parameter between min and max
+ */
+int
+next_number(int min, int max)
+{
+  char* word = next_word();
+  char* end;
+  long value = strtol(word, &end, 0);
+  if ((*end != 0) || (value < min) || (value > max))
+    {
+      fail("invalid number", word);
+    }
+  return value;
+}
+
+/*
+ * Get a named parameter
+ */
+uint8_t
+next_name(const name_value names[])
+{
+  char* word = next_word();
+  int i;
+  for (i = 0; names[i].name != NULL; i++)
+    {
+      if (strcmp(names[i].name, word) == 0)
+        {
+          return names[i].value;
+        }
+    }
+  fail("unknown name", word);
+  return 0;
+}
+
+/*
+ * Add a byte to the program
+ */
+void
+emit(uint8_t value)
+{
+  if (program_size >= MAX_PROGRAM_SIZE)
+    {
+      fail("program too long", program_name);
+    }
+  program[program_size++] = value;
+}
+
+/*
+ * Add an instruction to the program
+ */
+void
+emit_opcode(uint8_t opcode)
+{
+  emit(opcode);
+  program_last = opcode;
+}
+
+/*
+ * Add a jump to a label - the position is filled in at the end
+ */
+void
+emit_label(void)
+{
+  char* label = next_word();
+  if (jump_count >= MAX_LABELS)
+    {
+      fail("too many jumps", label);
+    }
+  strncpy(jump_names[jump_count], label, MAX_NAME - 1);
+  jump_positions[jump_count] = program_size;
+  jump_count++;
+  emit(0);
+}
+
+/*
+ * Resolve the labels and print the program
+ */
+void
+finish_program(void)
+{
+  int jump;
+  int i;
+  if (program_count == 0)
+    {
+      return;
+    }
+  if (loop_depth > 0)
+    {
+      fail("loop without next in", program_name);
+    }
+  for (jump = 0; jump < jump_count; jump++)
+    {
+      int label;
+      for (label = 0; label < label_count; label++)
+        {
+          if (strcmp(label_names[label], jump_names[jump]) == 0)
+            {
+              break;
+            }
+        }
+      if (label == label_count)
+        {
+          fail("unknown label", jump_names[jump]);
+        }
+      program[jump_positions[jump]] = label_positions[label];
+    }
+  //a program always ends
+  if (program_last != VM_END)
+    {
+      emit_opcode(VM_END);
+    }
+  printf("//%s\nconst prog_uint8_t vm_program_%i[] =\n  {",
+      program_name, program_count - 1);
+  for (i = 0; i < program_size; i++)
+    {
+      printf("%s 0x%02x%s", (i % 8) ? "" : "\n   ", program[i],
+          (i < program_size - 1) ? "," : "");
+    }
+  printf(" };\n\n");
+  total_size += program_size;
+}
+
+/*
+ * Assemble a line of the program file
+ */
+void
+assemble_line(char* line)
+{
+  char* comment = strchr(line, ';');
+  if (comment != NULL)
+    {
+      *comment = 0;
+    }
+  char* word = strtok(line, " \t\r\n");
+  if (word == NULL)
+    {
+      return;
+    }
+  if (strcmp(word, "program") == 0)
+    {
+      finish_program();
+      if (program_count >= MAX_PROGRAMS)
+        {
+          fail("too many programs", "");
+        }
+      strncpy(program_name, next_word(), MAX_NAME - 1);
+      program_size = 0;
+      program_last = -1;
+      loop_depth = 0;
+      label_count = 0;
+      jump_count = 0;
+      program_count++;
+      return;
+    }
+  if (program_count == 0)
+    {
+      fail("instruction outside of a program", word);
+    }
+  int length = strlen(word);
+  if (word[length - 1] == ':')
+    {
+      if (label_count >= MAX_LABELS)
+        {
+          fail("too many labels", word);
+        }
+      word[length - 1] = 0;
+      strncpy(label_names[label_count], word, MAX_NAME - 1);
+      label_positions[label_count] = program_size;
+      label_count++;
+    }
+  else if (strcmp(word, "sprite") == 0)
+    {
+      emit_opcode(VM_SPRITE);
+      emit(next_number(0, SPRITE_COUNT - 1));
+    }
+  else if (strcmp(word, "transformed") == 0)
+    {
+      emit_opcode(VM_TRANSFORMED);
+      emit(next_number(0, SPRITE_COUNT - 1));
+      emit(next_name(transformations));
+    }
+  else if (strcmp(word, "blit") == 0)
+    {
+      emit_opcode(VM_BLIT);
+      emit(next_number(0, SPRITE_COUNT - 1));
+      emit(next_number(-7, 7));
+      emit(next_number(-7, 7));
+      emit(next_name(modes));
+    }
+  else if (strcmp(word, "clear") == 0)
+    {
+      emit_opcode(VM_CLEAR);
+    }
+  else if (strcmp(word, "wait") == 0)
+    {
+      emit_opcode(VM_WAIT);
+      emit(next_number(1, 255));
+    }
+  else if (strcmp(word, "speed") == 0)
+    {
+      int speed = next_number(1, 65535);
+      emit_opcode(VM_SPEED);
+      emit(speed & 0xff);
+      emit(speed >> 8);
+    }
+  else if (strcmp(word, "loop") == 0)
+    {
+      if (loop_depth >= VM_LOOP_DEPTH)
+        {
+          fail("too many loops inside of each other", word);
+        }
+      loop_depth++;
+      emit_opcode(VM_LOOP);
+      emit(next_number(1, 255));
+    }
+  else if (strcmp(word, "next") == 0)
+    {
+      if (loop_depth == 0)
+        {
+          fail("next without loop", word);
+        }
+      loop_depth--;
+      emit_opcode(VM_NEXT);
+    }
+  else if (strcmp(word, "jump") == 0)
+    {
+      emit_opcode(VM_JUMP);
+      emit_label();
+    }
+  else if (strcmp(word, "chance") == 0)
+    {
+      emit_opcode(VM_CHANCE);
+      emit(next_number(0, 255));
+      emit_label();
+    }
+  else if (strcmp(word, "text") == 0)
+    {
+      emit_opcode(VM_TEXT);
+      emit(next_number(0, max_messages - 1));
+    }
+  else if (strcmp(word, "effect") == 0)
+    {
+      emit_opcode(VM_EFFECT);
+      emit(next_name(effects));
+      emit(next_number(1, 255));
+    }
+  else if (strcmp(word, "end") == 0)
+    {
+      emit_opcode(VM_END);
+    }
+  else
+    {
+      fail("unknown instruction", word);
+    }
+}
+
+int
+main(int argc, char* argv[])
+{
+  char line[256];
+  int i;
+  if (argc != 2)
+    {
+      fprintf(stderr, "usage: vm-assemble <program file>\n");
+      return 1;
+    }
+  file_name = argv[1];
+  FILE* file = fopen(file_name, "r");
+  if (file == NULL)
+    {
+      perror(file_name);
+      return 1;
+    }
+  printf("/*\n * vm-programs.c\n *\n"
+    " * Generated by tools/vm-assemble - do not edit, edit the programs in\n"
+    " * %s instead.\n */\n", file_name);
+  printf("#include <stdint.h>\n");
+  printf("#include <avr/pgmspace.h>\n\n");
+  printf("#include \"vm.h\"\n\n");
+  while (fgets(line, sizeof(line), file) != NULL)
+    {
+      line_number++;
+      assemble_line(line);
+    }
+  fclose(file);
+  finish_program();
+  printf("const prog_uint8_t* const vm_programs[] PROGMEM =\n  {");
+  for (i = 0; i < program_count; i++)
+    {
+      printf(" vm_program_%i%s", i, (i < program_count - 1) ? "," : "");
+    }
+  printf(" };\n");
+  fprintf(stderr, "vm-assemble: %i programs, %i bytes\n", program_count,
+      total_size);
+  return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * transform.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ * This file contains transformations of images, like rotating or mirroring.
+ * So a rotated or mirrored sprite does not need its own copy in the flash.
+ * It does not touch any hardware, so it is used by the Blinken Button and by
+ * the animation compressor in tools/sequence-encode.c.
+ *
+ * All transformations work on the whole image at once: the image is used as
+ * one 64 bit number, a byte for each row. Pixels are moved by swapping groups
+ * of bits with masks - e.g. mirroring a row swaps its nibbles, then the pairs
+ * of bits in each nibble, then the bits in each pair.
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+//we need the standard integer types
+#include <stdint.h>
+//and memory routines
+#include <string.h>
+
+//and we need our own definitions
+#include "transform.h"
+
+/*
+ * internal routines for the transformations
+ */
+uint64_t
+transform_transpose(uint64_t image);
+uint64_t
+transform_flip_horizontal(uint64_t image);
+uint64_t
+transform_flip_vertical(uint64_t image);
+
+/*
+ * Transform an image.
+ */
+void
+transform_image(uint8_t transform, uint8_t image[])
+{
+  uint64_t pixels;
+  memcpy(&pixels, image, sizeof(pixels));
+  switch (transform)
+    {
+  case TRANSFORM_TRANSPOSE:
+    pixels = transform_transpose(pixels);
+    break;
+  case TRANSFORM_ROTATE_90:
+    pixels = transform_flip_horizontal(transform_transpose(pixels));
+    break;
+  case TRANSFORM_ROTATE_180:
+    pixels = transform_flip_vertical(transform_flip_horizontal(pixels));
+    break;
+  case TRANSFORM_ROTATE_270:
+    pixels = transform_flip_vertical(transform_transpose(pixels));
+    break;
+  case TRANSFORM_FLIP_HORIZONTAL:
+    pixels = transform_flip_horizontal(pixels);
+    break;
+  case TRANSFORM_FLIP_VERTICAL:
+    pixels = transform_flip_vertical(pixels);
+    break;
+  case TRANSFORM_INVERT:
+    pixels = ~pixels;
+    break;
+  case TRANSFORM_SHIFT_LEFT:
+    pixels = ((pixels >> 1) & 0x7f7f7f7f7f7f7f7fULL) | ((pixels << 7)
+        & 0x8080808080808080ULL);
+    break;
+  case TRANSFORM_SHIFT_RIGHT:
+    pixels = ((pixels << 1) & 0xfefefefefefefefeULL) | ((pixels >> 7)
+        & 0x0101010101010101ULL);
+    break;
+  case TRANSFORM_SHIFT_UP:
+    pixels = (pixels >> 8) | (pixels << 56);
+    break;
+  case TRANSFORM_SHIFT_DOWN:
+    pixels = (pixels << 8) | (pixels >> 56);
+    break;
+  default:
+    return;
+    }
+  memcpy(image, &pixels, sizeof(pixels));
+}
+
+/*
+ * Swap rows & columns. The pixels are swapped in three steps: first the 4x4
+ * blocks top right & bottom left, then the 2x2 blocks in each 4x4 block, then
+ * the single pixels in each 2x2 block.
+ */
+uint64_t
+transform_transpose(uint64_t image)
+{
+  uint64_t swap;
+  swap = 0x0f0f0f0f00000000ULL & (image ^ (image << 28));
+  image ^= swap ^ (swap >> 28);
+  swap = 0x3333000033330000ULL & (image ^ (image << 14));
+  image ^= swap ^ (swap >> 14);
+  swap = 0x5500550055005500ULL & (image ^ (image << 7));
+  image ^= swap ^ (swap >> 7);
+  return image;
+}
+
+/*
+ * Mirror each row.
+ */
+uint64_t
+transform_flip_horizontal(uint64_t image)
+{
+  image = ((image >> 4) & 0x0f0f0f0f0f0f0f0fULL)
+      | ((image & 0x0f0f0f0f0f0f0f0fULL) << 4);
+  image = ((image >> 2) & 0x3333333333333333ULL)
+      | ((image & 0x3333333333333333ULL) << 2);
+  image = ((image >> 1) & 0x5555555555555555ULL)
+      | ((image & 0x5555555555555555ULL) << 1);
+  return image;
+}
+
+/*
+ * Reverse the order of the rows.
+ */
+uint64_t
+transform_flip_vertical(uint64_t image)
+{
+  image = ((image >> 32) & 0x00000000ffffffffULL) | (image << 32);
+  image = ((image >> 16) & 0x0000ffff0000ffffULL)
+      | ((image & 0x0000ffff0000ffffULL) << 16);
+  image = ((image >> 8) & 0x00ff00ff00ff00ffULL)
+      | ((image & 0x00ff00ff00ff00ffULL) << 8);
+  return image;
+}
@@ -0,0 +1,55 @@
+/*
+ * transform.h
+ *
+ * This file contains transformations of images, like rotating or mirroring.
+ *
+ *  http://interactive-matter.eu/
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TRANSFORM_H_
+#define TRANSFORM_H_
+
+/*
+ * The transformations. Rows are numbered from the top, columns from the left
+ * (bit 0 of each row is the left column).
+ */
+#define TRANSFORM_NONE 0
+//swap rows & columns (mirror at the diagonal from top left to bottom right)
+#define TRANSFORM_TRANSPOSE 1
+//rotate clockwise by 90, 180 or 270 degrees
+#define TRANSFORM_ROTATE_90 2
+#define TRANSFORM_ROTATE_180 3
+#define TRANSFORM_ROTATE_270 4
+//mirror left to right
+#define TRANSFORM_FLIP_HORIZONTAL 5
+//mirror top to bottom
+#define TRANSFORM_FLIP_VERTICAL 6
+//switch all pixels on & off
+#define TRANSFORM_INVERT 7
+//move the image one pixel - what leaves on one side comes back on the other
+#define TRANSFORM_SHIFT_LEFT 8
+#define TRANSFORM_SHIFT_RIGHT 9
+#define TRANSFORM_SHIFT_UP 10
+#define TRANSFORM_SHIFT_DOWN 11
+//how many transformations are there
+#define TRANSFORM_COUNT 12
+
+//transform the image (8 bytes, a byte for each row)
+void transform_image(uint8_t transform, uint8_t image[]);
+
+#endif /* TRANSFORM_H_ */
@@ -0,0 +1,123 @@
+/*
+ * transition.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ * This file contains transitions from one image to the next. Instead of
+ * simply switching to the new image it is wiped or slid in, or appears pixel
+ * by pixel in TRANSITION_STEPS steps.
+ * Each step takes about the same time as loading a sprite: wipes & dissolves
+ * use a mask, which pixels are taken from the new image (for the dissolve
+ * only the 8 new pixels of each step are added), slides simply shift both
+ * images.
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+//we need the standard integer types
+#include <stdint.h>
+//and memory routines
+#include <string.h>
+//we need some special register and tool definitions
+#include <avr/sfr_defs.h>
+//the order of the dissolve is stored in the flash
+#include <avr/pgmspace.h>
+
+//and we need our own definitions
+#include "transition.h"
+
+/*
+ * The order in which the pixels of the new image appear in a dissolve - each
+ * pixel is row * 8 + column. It is just a shuffled list of all 64 pixels.
+ */
+const prog_uint8_t transition_dissolve_order[64] =
+  { 1, 22, 21, 51, 6, 7, 20, 58, 43, 10, 55, 46, 53, 5, 35, 60, 54, 24, 30, 27,
+      0, 47, 23, 3, 4, 37, 9, 45, 33, 41, 18, 11, 42, 52, 26, 19, 2, 36, 59,
+      49, 50, 44, 39, 8, 61, 25, 62, 38, 63, 15, 48, 32, 12, 13, 16, 56, 28,
+      34, 40, 14, 29, 31, 57, 17 };
+
+//the current transition
+uint8_t transition_type;
+//the pixels of the dissolve which are already taken from the new image
+uint8_t transition_mask[8];
+
+/*
+ * Start a new transition.
+ */
+void
+transition_start(uint8_t transition)
+{
+  transition_type = transition;
+  memset(transition_mask, 0, sizeof(transition_mask));
+}
+
+/*
+ * Render a step of the current transition.
+ */
+void
+transition_render(uint8_t step, const uint8_t from[], const uint8_t to[],
+    uint8_t image[])
+{
+  uint8_t row;
+  switch (transition_type)
+    {
+  case TRANSITION_WIPE_LEFT:
+    //the first 'step' columns are new
+    for (row = 0; row < 8; row++)
+      {
+        uint8_t mask = (uint8_t) ((1 << step) - 1);
+        image[row] = (to[row] & mask) | (from[row] & ~mask);
+      }
+    break;
+  case TRANSITION_WIPE_TOP:
+    //the first 'step' rows are new
+    for (row = 0; row < 8; row++)
+      {
+        image[row] = (row < step) ? to[row] : from[row];
+      }
+    break;
+  case TRANSITION_SLIDE_LEFT:
+    //both images are moved 'step' columns to the left
+    for (row = 0; row < 8; row++)
+      {
+        image[row] = (uint8_t) ((from[row] >> step) | (to[row] << (8 - step)));
+      }
+    break;
+  case TRANSITION_SLIDE_UP:
+    //both images are moved 'step' rows up
+    for (row = 0; row < 8; row++)
+      {
+        uint8_t source = row + step;
+        image[row] = (source < 8) ? from[source] : to[source - 8];
+      }
+    break;
+  default:
+    {
+      //add the next 8 pixels of the dissolve to the mask
+      uint8_t index;
+      for (index = (step - 1) * 8; index < step * 8; index++)
+        {
+          uint8_t pixel = pgm_read_byte(&transition_dissolve_order[index]);
+          transition_mask[pixel >> 3] |= _BV(pixel & 7);
+        }
+      for (row = 0; row < 8; row++)
+        {
+          image[row] = (to[row] & transition_mask[row]) | (from[row]
+              & ~transition_mask[row]);
+        }
+    }
+    break;
+    }
+}
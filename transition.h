@@ -0,0 +1,51 @@
+/*
+ * transition.h
+ *
+ * This file contains transitions from one image to the next, like wiping or
+ * sliding the new image in.
+ *
+ *  http://interactive-matter.eu/
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TRANSITION_H_
+#define TRANSITION_H_
+
+//how many steps has a transition - after the last step the new image is shown
+#define TRANSITION_STEPS 8
+
+//the new image is wiped in from the left
+#define TRANSITION_WIPE_LEFT 0
+//the new image is wiped in from the top
+#define TRANSITION_WIPE_TOP 1
+//the old image is pushed out to the left by the new image
+#define TRANSITION_SLIDE_LEFT 2
+//the old image is pushed out to the top by the new image
+#define TRANSITION_SLIDE_UP 3
+//the new image appears pixel by pixel
+#define TRANSITION_DISSOLVE 4
+//how many transitions are there
+#define TRANSITION_COUNT 5
+
+//start a new transition
+void transition_start(uint8_t transition);
+//render a step (1 to TRANSITION_STEPS) of the transition from the image
+//'from' to the image 'to' into 'image' - the steps must be rendered in order
+void transition_render(uint8_t step, const uint8_t from[], const uint8_t to[],
+    uint8_t image[]);
+
+#endif /* TRANSITION_H_ */
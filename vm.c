@@ -0,0 +1,250 @@
+/*
+ * vm.c
+ *
+ *  http://interactive-matter.eu/
+ *
+ * This file contains a tiny interpreter for animation programs (see vm.h for
+ * the instructions). The programs are stored in flash and read directly from
+ * there.
+ * Each frame one instruction showing something is executed - so a program
+ * never takes more time than a sprite. Instructions lasting several frames
+ * (waiting or effects) just count their frames.
+ * The interpreter does not touch the display: it draws into an image and
+ * tells the animation what happened (see vm_execute).
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+//we need the standard integer types
+#include <stdint.h>
+//and memory routines
+#include <string.h>
+//we need some special register and tool definitions
+#include <avr/sfr_defs.h>
+//the programs are stored in the flash
+#include <avr/pgmspace.h>
+
+//we need the sprites
+#include "custom-flash-content.h"
+//programs can decide by chance
+#include "random.h"
+//and can transform sprites
+#include "transform.h"
+//and draw sprites over each other
+#include "blit.h"
+//and show effects
+#include "effects.h"
+//and we need our own definitions
+#include "vm.h"
+
+//the running program
+const prog_uint8_t* vm_program;
+//the position of the next instruction in the program
+const prog_uint8_t* vm_position;
+//the image the program draws into
+uint8_t* vm_image;
+//how many more frames the current instruction lasts (wait & effects)
+uint8_t vm_frames;
+//the effect shown by the current instruction
+uint8_t vm_effect;
+//the loops: where they start & how often they are still repeated
+const prog_uint8_t* vm_loop_start[VM_LOOP_DEPTH];
+uint8_t vm_loop_count[VM_LOOP_DEPTH];
+uint8_t vm_loop_depth;
+
+uint16_t vm_speed;
+uint8_t vm_text;
+
+/*
+ * Instructions which only change the flow of the program (speed, loops,
+ * jumps) do not take a frame: the next instruction is executed right away.
+ * But at most VM_STEPS_MAX in a frame - so even an endless loop without
+ * sprites cannot take more time than that.
+ */
+#define VM_STEPS_MAX 8
+//the instruction did not take a frame
+#define VM_RESULT_CONTINUE _BV(7)
+
+/*
+ * internal routines
+ */
+//execute a single instruction
+uint8_t
+vm_step(void);
+//read the next byte of the program
+uint8_t
+vm_read(void);
+//load a sprite from flash into the image
+void
+vm_load_sprite(uint8_t sprite);
+
+/*
+ * Start a program.
+ */
+void
+vm_start(const uint8_t* program, uint8_t image[])
+{
+  vm_program = program;
+  vm_position = program;
+  vm_image = image;
+  vm_frames = 0;
+  vm_loop_depth = 0;
+}
+
+/*
+ * Execute the instructions of the next frame: the instructions changing the
+ * flow of the program and then the one instruction which takes the frame.
+ * Returns what happened (VM_RESULT_...).
+ */
+uint8_t
+vm_execute(void)
+{
+  //an instruction lasting several frames
+  if (vm_frames > 0)
+    {
+      vm_frames--;
+      if (vm_effect != EFFECT_NONE)
+        {
+          effect_render(vm_effect, vm_image);
+          return VM_RESULT_SHOW;
+        }
+      return 0;
+    }
+  uint8_t result = 0;
+  uint8_t steps;
+  for (steps = 0; steps < VM_STEPS_MAX; steps++)
+    {
+      result |= vm_step();
+      if (!(result & VM_RESULT_CONTINUE))
+        {
+          break;
+        }
+      result &= ~VM_RESULT_CONTINUE;
+    }
+  return result;
+}
+
+/*
+ * Execute the next instruction of the program.
+ * Returns what happened (VM_RESULT_...).
+ */
+uint8_t
+vm_step(void)
+{
+  uint8_t instruction = vm_read();
+  switch (instruction)
+    {
+  case VM_SPRITE:
+    vm_load_sprite(vm_read());
+    return VM_RESULT_SHOW;
+  case VM_TRANSFORMED:
+    {
+      vm_load_sprite(vm_read());
+      transform_image(vm_read(), vm_image);
+    }
+    return VM_RESULT_SHOW;
+  case VM_BLIT:
+    {
+      uint8_t sprite[8];
+      memcpy_P(sprite, predefined_sprites[vm_read()], sizeof(sprite));
+      int8_t x = vm_read();
+      int8_t y = vm_read();
+      blit_sprite(vm_image, sprite, x, y, vm_read());
+    }
+    return VM_RESULT_SHOW;
+  case VM_CLEAR:
+    memset(vm_image, 0, 8);
+    return VM_RESULT_SHOW;
+  case VM_WAIT:
+    vm_effect = EFFECT_NONE;
+    //this frame is the first one
+    vm_frames = vm_read() - 1;
+    return 0;
+  case VM_SPEED:
+    vm_speed = vm_read();
+    vm_speed |= vm_read() << 8;
+    return VM_RESULT_SPEED | VM_RESULT_CONTINUE;
+  case VM_LOOP:
+    {
+      uint8_t count = vm_read();
+      if (vm_loop_depth < VM_LOOP_DEPTH)
+        {
+          vm_loop_start[vm_loop_depth] = vm_position;
+          vm_loop_count[vm_loop_depth] = count;
+          vm_loop_depth++;
+        }
+    }
+    return VM_RESULT_CONTINUE;
+  case VM_NEXT:
+    if (vm_loop_depth > 0)
+      {
+        uint8_t loop = vm_loop_depth - 1;
+        vm_loop_count[loop]--;
+        if (vm_loop_count[loop] > 0)
+          {
+            vm_position = vm_loop_start[loop];
+          }
+        else
+          {
+            vm_loop_depth--;
+          }
+      }
+    return VM_RESULT_CONTINUE;
+  case VM_JUMP:
+    vm_position = vm_program + vm_read();
+    return VM_RESULT_CONTINUE;
+  case VM_CHANCE:
+    {
+      uint8_t chance = vm_read();
+      uint8_t position = vm_read();
+      if (get_random(256) < chance)
+        {
+          vm_position = vm_program + position;
+        }
+    }
+    return VM_RESULT_CONTINUE;
+  case VM_TEXT:
+    vm_text = vm_read();
+    return VM_RESULT_TEXT;
+  case VM_EFFECT:
+    vm_effect = vm_read();
+    vm_frames = vm_read() - 1;
+    effect_start(vm_effect, vm_image);
+    effect_render(vm_effect, vm_image);
+    return VM_RESULT_SHOW;
+  default:
+    //the end (or something we do not understand) - stay at the end
+    vm_position--;
+    return VM_RESULT_END;
+    }
+}
+
+/*
+ * Read the next byte of the program.
+ */
+uint8_t
+vm_read(void)
+{
+  return pgm_read_byte(vm_position++);
+}
+
+/*
+ * Load a sprite into the image.
+ */
+void
+vm_load_sprite(uint8_t sprite)
+{
+  memcpy_P(vm_image, predefined_sprites[sprite], 8);
+}
@@ -0,0 +1,93 @@
+/*
+ * vm.h
+ *
+ * This file contains a tiny interpreter for animation programs. A program
+ * can do much more than a sequence of sprites: loops, jumps, changing the
+ * speed, texts, drawing sprites over each other & effects.
+ *
+ *  http://interactive-matter.eu/
+ *
+ *  This file is part of Blinken Button.
+ *
+ *  Blinken Button is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Blinken Button is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with Blinken Button.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef VM_H_
+#define VM_H_
+
+/*
+ * The instructions of a program. Each instruction is a byte, followed by its
+ * parameters (each a byte, if not noted otherwise). All instructions which
+ * change the image show it for one frame, waits and effects take their
+ * frames. Speed, loops & jumps take no frame - they are executed together
+ * with the next instruction.
+ * The programs are written in custom-programs.vm and translated by
+ * tools/vm-assemble while building (see there for the syntax).
+ */
+//the program is finished
+#define VM_END 0x00
+//sprite: show a sprite of predefined_sprites
+#define VM_SPRITE 0x01
+//sprite, transformation: show a transformed sprite (see transform.h)
+#define VM_TRANSFORMED 0x02
+//sprite, x, y, mode: draw a sprite over the image (see blit.h)
+#define VM_BLIT 0x03
+//show an empty image
+#define VM_CLEAR 0x04
+//frames: keep the image for some more frames
+#define VM_WAIT 0x05
+//ms (2 bytes, low byte first): set how long a frame is shown
+#define VM_SPEED 0x06
+//count: repeat everything up to the next VM_NEXT count times
+#define VM_LOOP 0x07
+//the end of a loop
+#define VM_NEXT 0x08
+//position: continue at a position in the program
+#define VM_JUMP 0x09
+//chance, position: jump with a chance of chance/256
+#define VM_CHANCE 0x0a
+//message: display a message of messages[]
+#define VM_TEXT 0x0b
+//effect, frames: show an effect (see effects.h) for some frames
+#define VM_EFFECT 0x0c
+
+//how many loops can be inside of each other
+#define VM_LOOP_DEPTH 4
+
+/*
+ * What happened executing an instruction - several can happen at once
+ */
+//the image has changed and needs to be displayed
+#define VM_RESULT_SHOW _BV(0)
+//the speed has changed (see vm_speed)
+#define VM_RESULT_SPEED _BV(1)
+//a text should be displayed (see vm_text)
+#define VM_RESULT_TEXT _BV(2)
+//the program is finished
+#define VM_RESULT_END _BV(3)
+
+//the speed set by the program (ms per frame)
+extern uint16_t vm_speed;
+//the text the program wants to display
+extern uint8_t vm_text;
+
+//the programs, generated from custom-programs.vm
+extern const prog_uint8_t* const vm_programs[] PROGMEM;
+
+//start a program - it draws into image
+void vm_start(const uint8_t* program, uint8_t image[]);
+//execute the instructions of the next frame - once each frame
+uint8_t vm_execute(void);
+
+#endif /* VM_H_ */